@@ -67,11 +67,79 @@ struct BerryDetail {
     int flavorScore() const { return spicy + fresh + sweet + bitter + sour; }
 };
 
+// Flavor groups the batch fills pick from.
+enum class FlavorFamily : uint8_t {
+    Other,
+    Sparkling,
+    Catching,
+    Alpha,
+    Humungo,
+    Teensy,
+};
+
+// Level, category and family are parsed from the name at compile time.
+// Names read "<Category> (Lv. N)" or "<Category>: <Type> (Lv. N)"; the
+// single-level powers have no suffix and level 0.
 struct FlavorEntry {
     uint64_t hash;
     const char* name;
+    uint32_t category; // same value <=> same category prefix
+    uint8_t level;
+    FlavorFamily family;
+
+    constexpr FlavorEntry(uint64_t h, const char* n)
+        : hash(h), name(n), category(categoryId(n, categoryLen(n))),
+          level(parseLevel(n)), family(parseFamily(category)) {}
+
+    // Length of the category prefix: up to ": " or " (", else the whole name.
+    static constexpr int categoryLen(const char* n) {
+        int len = 0;
+        while (n[len] && !(n[len] == ':' && n[len + 1] == ' ') &&
+               !(n[len] == ' ' && n[len + 1] == '('))
+            len++;
+        return len;
+    }
+    // FNV-1a over the category prefix.
+    static constexpr uint32_t categoryId(const char* n, int len) {
+        uint32_t h = 2166136261u;
+        for (int i = 0; i < len; i++)
+            h = (h ^ static_cast<uint8_t>(n[i])) * 16777619u;
+        return h;
+    }
+    static constexpr uint32_t categoryId(const char* n) {
+        return categoryId(n, categoryLen(n));
+    }
+
+private:
+    static constexpr uint8_t parseLevel(const char* n) {
+        int len = 0;
+        while (n[len]) len++;
+        if (len < 7 || n[len - 7] != '(' || n[len - 6] != 'L' || n[len - 5] != 'v' ||
+            n[len - 4] != '.' || n[len - 3] != ' ' || n[len - 1] != ')')
+            return 0;
+        return static_cast<uint8_t>(n[len - 2] - '0');
+    }
+    static constexpr FlavorFamily parseFamily(uint32_t category) {
+        if (category == categoryId("Sparkling Power")) return FlavorFamily::Sparkling;
+        if (category == categoryId("Catching Power")) return FlavorFamily::Catching;
+        if (category == categoryId("Alpha Power")) return FlavorFamily::Alpha;
+        if (category == categoryId("Humungo Power")) return FlavorFamily::Humungo;
+        if (category == categoryId("Teensy Power")) return FlavorFamily::Teensy;
+        return FlavorFamily::Other;
+    }
 };
 
+// Legality problems DonutInfo::auditPocket() flags, one bit each.
+namespace DonutIssue {
+    constexpr uint8_t BadBerry     = 1 << 0; // berry ID not a known berry
+    constexpr uint8_t BadFlavor    = 1 << 1; // flavor hash not in FLAVORS
+    constexpr uint8_t StatMismatch = 1 << 2; // stars/calories/boost/sprite/berryName != recalcStats
+    constexpr uint8_t BadDateTime  = 1 << 3; // DateTime1900 doesn't match the timestamp
+    constexpr uint8_t DupTimestamp = 1 << 4; // another slot has the same timestamp
+    constexpr uint8_t Reserved     = 1 << 5; // reserved bytes 0x40-0x47 not zero
+    constexpr int COUNT = 6; // bits above
+}
+
 namespace DonutInfo {
     extern const BerryDetail BERRIES[];
     extern const int BERRY_COUNT;
@@ -88,9 +156,11 @@ namespace DonutInfo {
     uint8_t calcStarRating(int flavorScore);
     int findValidBerryIndex(uint16_t item);
 
-    void fillOneShiny(Donut9a& d);
-    void fillOneShinyRandom(Donut9a& d);
-    void fillOneRandomLv3(Donut9a& d);
+    // Single-slot fills. Given the pocket d lives in, the new timestamp is
+    // kept unique in it.
+    void fillOneShiny(Donut9a& d, const uint8_t* blockData = nullptr);
+    void fillOneShinyRandom(Donut9a& d, const uint8_t* blockData = nullptr);
+    void fillOneRandomLv3(Donut9a& d, const uint8_t* blockData = nullptr);
     void fillAllShiny(uint8_t* blockData);
     void fillAllRandomLv3(uint8_t* blockData);
     void compress(uint8_t* blockData);
@@ -105,4 +175,12 @@ namespace DonutInfo {
 
     // Recalculate Stars, Calories, LevelBoost from berries
     void recalcStats(Donut9a& d);
+    // recalcStats on every slot with selected[i] set (all slots when
+    // selected is null), a batch of donuts at a time. Same results.
+    void recalcAll(uint8_t* blockData, const bool* selected = nullptr);
+
+    // Audits slots into issues[Donut9a::MAX_COUNT] as DonutIssue bits; empty
+    // slots have none. Only slots with dirty[i] set are rechecked (all when
+    // dirty is null), but duplicate timestamps are always redone in full.
+    void auditPocket(const uint8_t* blockData, uint8_t* issues, const bool* dirty = nullptr);
 }
@@ -4,11 +4,17 @@
 #include "game_type.h"
 #include <vector>
 #include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <utility>
 
 // SaveFile - manages a Pokemon save file for donut editing.
 // SCBlock-based (ZA/SV/SwSh/LA) — only ZA has donut data.
 class SaveFile {
 public:
+    ~SaveFile() { waitVerify(); }
+
     void setGameType(GameType game);  // must call before load()
 
     bool load(const std::string& path);
@@ -21,22 +27,60 @@ public:
 
     bool isLoaded() const { return loaded_; }
     bool hasDonutBlock() const { return donutData_ != nullptr; }
+    // Donut block content differs from the last load/save, or a save
+    // failed to reach the disk.
+    bool hasUnsavedChanges() const;
+
+    // Writes a SavePatch of the donut block against its state at load.
+    bool exportPatch(const std::string& path) const;
+    // Applies a SavePatch to the loaded save through the block directory;
+    // save() then re-encrypts and writes the changes. Nothing is applied
+    // unless every entry fits its block.
+    bool applyPatch(const std::string& path);
 
-    // Debug: verify encrypt(decrypt(file)) == file. Call right after load().
+    // Debug: verify encrypt(decrypt(file)) == file by comparing the SHA-256
+    // of the streamed re-encryption with the digest of the image as last
+    // loaded or saved. Unsaved edits are not part of the check. Blocks until
+    // it is done.
     std::string verifyRoundTrip();
+    // Same check on a worker thread. The saved donut block is snapshotted
+    // first, so the live one can be edited while the check runs.
+    void startVerify();
+    // True once, when a started check has finished; result is "OK" or why not.
+    bool pollVerify(std::string& result);
 
 private:
-    std::vector<SCBlock> blocks_;
+    SCBlockStore blocks_;
+    SCBlock* donutBlock_ = nullptr;
     uint8_t* donutData_ = nullptr;
     size_t donutDataLen_ = 0;
+    // Donut plaintext as last loaded or saved; save() re-encrypts only the
+    // slots that differ from it.
+    std::unique_ptr<uint8_t[]> savedDonuts_;
+    std::unique_ptr<uint8_t[]> loadedDonuts_; // baseline for exportPatch()
+    // Image byte ranges (offset, length) patched since they were last
+    // written to diskPath_; save() seeks to and writes only these.
+    std::vector<std::pair<size_t, size_t>> unwrittenRanges_;
+    std::string diskPath_;
     bool loaded_ = false;
+    size_t fileSize_ = 0;
+    uint8_t fileDigest_[32] = {}; // SHA-256 of the image as last loaded or saved
+    bool fileDigestValid_ = false;
+
+    std::thread verifyThread_;
+    std::atomic<bool> verifyDone_{false};
+    bool verifyPending_ = false;
+    std::string verifyResult_;
+    SCBlock verifyBlock_{};
+    std::unique_ptr<uint8_t[]> verifySnapshot_;
+
+    void waitVerify();
+    void ensureFileDigest();
+    void markUnwritten(size_t offset, size_t len);
 
     GameType gameType_ = GameType::ZA;
     mutable int cachedDonutCount_ = -1;
 
     // Block key for donuts from SaveBlockAccessor9ZA.cs
     static constexpr uint32_t KDONUTS = 0xBE007476;
-
-    // Original file data for round-trip verification (cleared after verify)
-    std::vector<uint8_t> originalFileData_;
 };
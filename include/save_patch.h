@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// SavePatch - compact binary delta of decrypted block payloads.
+// Layout (all little-endian): "PKBP", u32 version, u32 entry count, then
+// per entry u32 block key, u32 offset in the block payload, u32 length and
+// that many new bytes.
+namespace SavePatch {
+    constexpr uint32_t VERSION = 1;
+
+    struct Entry {
+        uint32_t key;
+        uint32_t offset;
+        std::vector<uint8_t> bytes;
+    };
+
+    // Appends an entry per run of len bytes where cur differs from base.
+    // Runs separated by less than an entry header are merged.
+    void diff(std::vector<Entry>& entries, uint32_t key,
+              const uint8_t* base, const uint8_t* cur, size_t len);
+    std::vector<uint8_t> serialize(const std::vector<Entry>& entries);
+    // False if the data is not a well-formed patch of this version.
+    bool parse(const uint8_t* data, size_t len, std::vector<Entry>& entries);
+}
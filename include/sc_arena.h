@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// SCArena - bump allocator that owns the decrypted block payloads of one
+// save. Blocks borrow byte-packed slices of it; everything is released at
+// once when the arena (and the SCBlockStore holding it) goes away, so the
+// heap sees a handful of large allocations instead of one per block.
+class SCArena {
+public:
+    // Make the next slab at least capacity bytes, e.g. sized from the file.
+    void reserve(size_t capacity);
+    // len bytes, uninitialized. Successive calls are contiguous while the
+    // current slab has room.
+    uint8_t* alloc(size_t len);
+
+private:
+    static constexpr size_t MIN_SLAB = 0x10000;
+
+    std::vector<std::unique_ptr<uint8_t[]>> slabs_;
+    uint8_t* cursor_ = nullptr;
+    size_t left_ = 0;
+
+    void newSlab(size_t size);
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
-#include <vector>
+#include <cstring>
+#include <array>
 #include <bit>
 
 // SCXorShift32 - PRNG used to encrypt/decrypt SCBlock fields.
@@ -21,7 +22,75 @@ public:
     }
 
     int32_t next32() {
-        return next() | (next() << 8) | (next() << 16) | (next() << 24);
+        return static_cast<int32_t>(nextWord());
+    }
+
+    // Next 4 keystream bytes as a little-endian word (one xorshift advance
+    // when the stream is word-aligned).
+    uint32_t nextWord() {
+        if (counter_ == 0) {
+            uint32_t result = state_;
+            state_ = xorshiftAdvance(state_);
+            return result;
+        }
+        uint32_t result = next();
+        result |= static_cast<uint32_t>(next()) << 8;
+        result |= static_cast<uint32_t>(next()) << 16;
+        result |= static_cast<uint32_t>(next()) << 24;
+        return result;
+    }
+
+    // Discard the next n keystream bytes.
+    void skip(size_t n) {
+        while (counter_ != 0 && n > 0) {
+            next();
+            n--;
+        }
+        jump(n / 4);
+        for (n %= 4; n > 0; n--)
+            next();
+    }
+
+    // Advance by n whole words (4 keystream bytes each), keeping the byte
+    // phase. The xorshift step is linear over GF(2), so large jumps apply
+    // precomputed powers of its matrix: O(log n) instead of O(n).
+    void jump(uint64_t n);
+
+    uint64_t next64() {
+        uint64_t lo = nextWord();
+        return lo | (static_cast<uint64_t>(nextWord()) << 32);
+    }
+
+    // dst[i] = src[i] ^ keystream for len bytes. dst may alias src.
+    // Byte-steps until the stream is word-aligned, then XORs 16 bytes per
+    // iteration (four advances) before finishing the tail byte-wise.
+    void xorInto(uint8_t* dst, const uint8_t* src, size_t len) {
+        size_t i = 0;
+        while (counter_ != 0 && i < len) {
+            dst[i] = src[i] ^ next();
+            i++;
+        }
+        for (; i + 16 <= len; i += 16) {
+            uint32_t s0 = state_;
+            uint32_t s1 = xorshiftAdvance(s0);
+            uint32_t s2 = xorshiftAdvance(s1);
+            uint32_t s3 = xorshiftAdvance(s2);
+            state_ = xorshiftAdvance(s3);
+            uint64_t w[2];
+            std::memcpy(w, src + i, 16);
+            w[0] ^= s0 | (static_cast<uint64_t>(s1) << 32);
+            w[1] ^= s2 | (static_cast<uint64_t>(s3) << 32);
+            std::memcpy(dst + i, w, 16);
+        }
+        for (; i + 4 <= len; i += 4) {
+            uint32_t w;
+            std::memcpy(&w, src + i, 4);
+            w ^= state_;
+            state_ = xorshiftAdvance(state_);
+            std::memcpy(dst + i, &w, 4);
+        }
+        for (; i < len; i++)
+            dst[i] = src[i] ^ next();
     }
 
 private:
@@ -35,12 +104,17 @@ private:
         return state;
     }
 
-    static uint32_t xorshiftAdvance(uint32_t state) {
+    static constexpr uint32_t xorshiftAdvance(uint32_t state) {
         state ^= state << 2;
         state ^= state >> 15;
         state ^= state << 13;
         return state;
     }
+
+    // JUMP_POWERS[k][j] is column j of the step matrix raised to 2^k.
+    using JumpMatrix = std::array<uint32_t, 32>;
+    static const std::array<JumpMatrix, 64> JUMP_POWERS;
+    static constexpr std::array<JumpMatrix, 64> buildJumpPowers();
 };
 
 // SCTypeCode - block data types.
@@ -80,13 +154,49 @@ inline int getTypeSize(SCTypeCode type) {
     }
 }
 
+// SCBlock - one block of an SCBlock save. offset/dataOffset locate the
+// encoded block and its payload in the save payload; data points at the
+// decrypted payload (owned by the SCBlockStore) once it has been decrypted.
 struct SCBlock {
     uint32_t key;
     SCTypeCode type;
     SCTypeCode subType = SCTypeCode::None;
-    std::vector<uint8_t> data;
+    size_t offset = 0;
+    size_t dataOffset = 0;
+    size_t dataLen = 0;
+    uint8_t* data = nullptr;
+    bool dirty = false; // payload edited since load; encrypt() re-serializes it
+
+    // Key, type, 4-byte length and array subtype.
+    static constexpr size_t MAX_HEADER_SIZE = 10;
 
-    static SCBlock readFromOffset(const uint8_t* buf, size_t bufLen, size_t& offset);
+    // Decodes the header of the block at offset. hdr holds the (static pad
+    // stripped) bytes from offset on, at most MAX_HEADER_SIZE of them.
+    static SCBlock readHeader(const uint8_t* hdr, size_t offset);
+    // XOR len payload bytes with the block keystream; encrypts and decrypts.
+    void cryptPayload(uint8_t* dst, const uint8_t* src) const;
+    // Same for payload bytes [pos, pos + len) only, jumping the keystream
+    // straight to pos.
+    void cryptPayloadRange(uint8_t* dst, const uint8_t* src, size_t pos, size_t len) const;
+    // Writes key, type, length and subtype, leaving xk at the payload.
+    size_t writeHeader(uint8_t* out, SCXorShift32& xk) const;
     size_t writeBlock(uint8_t* out) const;
     size_t encodedSize() const;
 };
+
+// SCBlockWriter - emits a block's encoded bytes front to back in pieces of
+// any size, carrying the keystream from one call to the next.
+class SCBlockWriter {
+public:
+    explicit SCBlockWriter(const SCBlock& block);
+
+    // Writes the next len encoded bytes.
+    void write(uint8_t* out, size_t len);
+
+private:
+    const SCBlock* block_;
+    SCXorShift32 xk_;
+    uint8_t header_[SCBlock::MAX_HEADER_SIZE];
+    size_t headerLen_;
+    size_t pos_ = 0;
+};
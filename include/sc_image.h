@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// SCImage - the encrypted bytes of a save file. Either owns a buffer read
+// into memory or, on Linux, is a private copy-on-write mapping of the file:
+// only the pages that are read get faulted in, and writes (patchImage)
+// never reach the file by themselves.
+class SCImage {
+public:
+    SCImage() = default;
+    explicit SCImage(std::vector<uint8_t> bytes) : owned_(std::move(bytes)) {}
+    ~SCImage();
+    SCImage(SCImage&& other) noexcept;
+    SCImage& operator=(SCImage&& other) noexcept;
+    SCImage(const SCImage&) = delete;
+    SCImage& operator=(const SCImage&) = delete;
+
+    // Maps path with MAP_PRIVATE. Returns false (leaving the image empty)
+    // where mmap is unavailable or the file can't be mapped.
+    bool mapFile(const std::string& path);
+    bool isMapped() const { return map_ != nullptr; }
+
+    uint8_t* data() { return map_ ? map_ : owned_.data(); }
+    const uint8_t* data() const { return map_ ? map_ : owned_.data(); }
+    size_t size() const { return map_ ? mapLen_ : owned_.size(); }
+    bool empty() const { return size() == 0; }
+
+private:
+    std::vector<uint8_t> owned_;
+    uint8_t* map_ = nullptr;
+    size_t mapLen_ = 0;
+
+    void unmap();
+};
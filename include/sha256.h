@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// SHA-256 for the SwishCrypto trailer hash.
+// The block transform is a pluggable backend picked once from the CPU's
+// features: ARMv8 Crypto Extensions, x86 SHA-NI, or portable scalar code.
+
+struct SHA256_CTX {
+    uint32_t state[8];
+    uint64_t bitcount;
+    uint8_t  buffer[64];
+};
+
+void sha256_init(SHA256_CTX* ctx);
+void sha256_update(SHA256_CTX* ctx, const uint8_t* data, size_t len);
+void sha256_final(SHA256_CTX* ctx, uint8_t hash[32]);
+
+// Compresses `blocks` consecutive 64-byte blocks into state.
+typedef void (*SHA256TransformFn)(uint32_t state[8], const uint8_t* data, size_t blocks);
+
+struct SHA256Backend {
+    const char* name;
+    SHA256TransformFn transform;
+    bool (*supported)();
+};
+
+// Every backend compiled into this build, fastest first. The scalar
+// backend is always last and always supported.
+const SHA256Backend* sha256Backends(int& count);
+
+// Backend in use: the first supported one (scalar on the Switch for now),
+// unless overridden.
+const SHA256Backend& sha256ActiveBackend();
+void sha256SetBackend(const SHA256Backend& backend);
@@ -1,12 +1,81 @@
 #pragma once
 #include "sc_block.h"
+#include "sc_arena.h"
+#include "sc_image.h"
 #include <vector>
+#include <memory>
+#include <functional>
 #include <cstdint>
 
+// Key -> position in SCBlockStore::blocks.
+struct SCBlockKeyIndex {
+    uint32_t key;
+    uint32_t block;
+};
+
+// SHA-256 chaining state after hashing the intro and the first
+// k * SCBlockStore::HASH_CHECKPOINT_INTERVAL payload bytes of the image.
+struct SCHashCheckpoint {
+    uint32_t state[8];
+};
+
+// SCBlockStore - a loaded save. image is the encrypted file (static pad
+// applied, hash trailer included) as read or last patched by patchImage(),
+// so clean blocks can be written back straight from it. Decrypted payloads
+// live in arena and are reached through SCBlock::data.
+struct SCBlockStore {
+    SCImage image;
+    std::vector<SCBlock> blocks;
+    std::vector<SCBlockKeyIndex> keyIndex; // sorted by key, built by decrypt()
+    SCArena arena; // owns every decrypted payload
+    // Recorded by decrypt() so encrypt() can resume the trailer hash at the
+    // last checkpoint before the first dirty block.
+    std::vector<SCHashCheckpoint> hashCheckpoints;
+
+    static constexpr size_t HASH_CHECKPOINT_INTERVAL = 0x10000;
+
+    size_t payloadSize() const {
+        return blocks.empty() ? 0 : blocks.back().offset + blocks.back().encodedSize();
+    }
+
+    // Payload of b, decrypting it on first access.
+    uint8_t* data(SCBlock& b);
+};
+
 namespace SwishCrypto {
-    void cryptStaticXorpadBytes(uint8_t* data, size_t len);
-    std::vector<SCBlock> decrypt(uint8_t* fileData, size_t fileSize);
-    std::vector<uint8_t> encrypt(const std::vector<SCBlock>& blocks);
-    SCBlock* findBlock(std::vector<SCBlock>& blocks, uint32_t key);
-    const SCBlock* findBlock(const std::vector<SCBlock>& blocks, uint32_t key);
+    // Length of the SHA-256 trailer at the end of the file.
+    static constexpr size_t SIZE_HASH = 32;
+
+    // Full decrypts every payload up front. Lazy only walks the block
+    // headers; payloads are decrypted on first SCBlockStore::data() access.
+    enum class DecryptMode { Full, Lazy };
+
+    // fileOffset is the position of data[0] in the save, which sets the
+    // phase of the 127-byte pad.
+    void cryptStaticXorpadBytes(uint8_t* data, size_t len, size_t fileOffset = 0);
+    // Takes ownership of the file buffer as the store's image. A block whose
+    // payload runs past the payload end leaves the store empty.
+    SCBlockStore decrypt(std::vector<uint8_t> fileData, DecryptMode mode = DecryptMode::Full);
+    // Same, for an image that may be a file mapping. For a mapped image
+    // the hash checkpoints are left to the first refreshImageHash(), so a
+    // Lazy load reads little more than the block headers.
+    SCBlockStore decrypt(SCImage image, DecryptMode mode = DecryptMode::Full);
+    // Copies the image, re-encrypting only dirty blocks, and rehashes from
+    // the first dirty block on.
+    std::vector<uint8_t> encrypt(const SCBlockStore& store);
+    // Receives the encrypted file in order, a chunk at a time; returning
+    // false stops the stream.
+    using ChunkSink = std::function<bool(const uint8_t* data, size_t len)>;
+    // Same bytes as encrypt(), without holding the output. substitute, if
+    // set, is encoded in place of the stored block with the same key.
+    bool encryptStream(const SCBlockStore& store, const ChunkSink& sink,
+                       const SCBlock* substitute = nullptr);
+    // Re-encrypts payload bytes [pos, pos + len) of b from b.data straight
+    // into the image. Follow with refreshImageHash() before writing it out.
+    bool patchImage(SCBlockStore& store, const SCBlock& b, size_t pos, size_t len);
+    // Rehashes the image from the checkpoint before payload offset from,
+    // updating later checkpoints and the trailer.
+    void refreshImageHash(SCBlockStore& store, size_t from);
+    SCBlock* findBlock(SCBlockStore& store, uint32_t key);
+    const SCBlock* findBlock(const SCBlockStore& store, uint32_t key);
 }
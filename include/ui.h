@@ -24,7 +24,8 @@ enum class EditField {
 enum class BatchOp {
     OneShiny, OneShinyRandom, OneRandomLv3,
     FillShiny, FillRandomLv3, CloneToAll, DeleteSelected,
-    DeleteAll, Compress, ExportDonut, ImportDonut, Cancel,
+    DeleteAll, Compress, ExportDonut, ImportDonut,
+    ExportPatch, ApplyPatch, Cancel,
     COUNT
 };
 
@@ -128,6 +129,12 @@ private:
     void clearMultiSelect();
     void applyToMultiSelected(int sourceIdx);
 
+    // Legality audit: DonutIssue bits per slot, rechecked for slots that
+    // differ from auditedDonuts_ (the block as last audited).
+    uint8_t donutIssues_[Donut9a::MAX_COUNT] = {};
+    std::vector<uint8_t> auditedDonuts_;
+    void refreshAudit();
+
     // Import file picker state
     std::vector<std::string> importFiles_;
     int importCursor_ = 0;
@@ -213,6 +220,8 @@ private:
     std::string showKeyboard(const std::string& defaultText);
     std::string sanitizeFilename(const std::string& input);
     std::string buildDefaultExportName(int index);
+    bool exportSavePatch();
+    bool applySavePatch();
 
     // Utility
     int totalPages();
@@ -2,33 +2,41 @@
 #include <cstdio>
 #include <ctime>
 #include <cstring>
+#include <algorithm>
+#include <utility>
 
 // --- Donut9a ---
 
+// DateTime1900 packed bitfield at offset 0x20 for a millisecond timestamp,
+// in local time. Format: bits[0:11]=year-1900, [12:15]=month(0-idx),
+// [16:20]=day, [21:25]=hour, [26:31]=minute, byte[4]=second
+static bool packDateTime1900(uint64_t ms, uint8_t out[8]) {
+    time_t secs = static_cast<time_t>(ms / 1000);
+    struct tm* t = localtime(&secs);
+    if (!t)
+        return false;
+    uint32_t raw = 0;
+    raw |= static_cast<uint32_t>(t->tm_year) & 0xFFF;
+    raw |= (static_cast<uint32_t>(t->tm_mon) & 0xF) << 12;
+    raw |= (static_cast<uint32_t>(t->tm_mday) & 0x1F) << 16;
+    raw |= (static_cast<uint32_t>(t->tm_hour) & 0x1F) << 21;
+    raw |= (static_cast<uint32_t>(t->tm_min) & 0x3F) << 26;
+    std::memcpy(out, &raw, 4);
+    out[4] = static_cast<uint8_t>(t->tm_sec);
+    out[5] = 0;
+    out[6] = 0;
+    out[7] = 0;
+    return true;
+}
+
 void Donut9a::applyTimestamp(int bias) {
     auto now = static_cast<uint64_t>(time(nullptr)) * 1000ULL;
     if (bias != 0)
         now += static_cast<uint64_t>(bias);
     setMillisecondsSince1970(now);
 
-    // Also set DateTime1900 packed bitfield at offset 0x20
-    // Format: bits[0:11]=year-1900, [12:15]=month(0-idx), [16:20]=day,
-    //         [21:25]=hour, [26:31]=minute, byte[4]=second
-    time_t secs = static_cast<time_t>(now / 1000);
-    struct tm* t = localtime(&secs);
-    if (t) {
-        uint32_t raw = 0;
-        raw |= static_cast<uint32_t>(t->tm_year) & 0xFFF;
-        raw |= (static_cast<uint32_t>(t->tm_mon) & 0xF) << 12;
-        raw |= (static_cast<uint32_t>(t->tm_mday) & 0x1F) << 16;
-        raw |= (static_cast<uint32_t>(t->tm_hour) & 0x1F) << 21;
-        raw |= (static_cast<uint32_t>(t->tm_min) & 0x3F) << 26;
-        std::memcpy(data + 0x20, &raw, 4);
-        data[0x24] = static_cast<uint8_t>(t->tm_sec);
-        data[0x25] = 0;
-        data[0x26] = 0;
-        data[0x27] = 0;
-    }
+    // Also set DateTime1900
+    packDateTime1900(now, data + 0x20);
 }
 
 // --- Simple PRNG for batch operations ---
@@ -51,7 +59,7 @@ static uint32_t nextRand() {
 
 // Berry data from PKHeX.Core DonutInfo.Berries
 // (item, donutIdx, spicy, fresh, sweet, bitter, sour, boost, calories)
-const BerryDetail DonutInfo::BERRIES[] = {
+constexpr BerryDetail DonutInfo::BERRIES[] = {
     {149,  0, 10,  0,  0,  0,  0, 1,  60},
     {150,  1,  0, 10,  0,  0,  0, 1,  60},
     {151,  2,  0,  0, 10,  0,  0, 1,  60},
@@ -121,10 +129,10 @@ const BerryDetail DonutInfo::BERRIES[] = {
     {2683, 32, 65,  0,  0,  0, 85,10, 340},
 };
 
-const int DonutInfo::BERRY_COUNT = sizeof(DonutInfo::BERRIES) / sizeof(DonutInfo::BERRIES[0]);
+constexpr int DonutInfo::BERRY_COUNT = sizeof(DonutInfo::BERRIES) / sizeof(DonutInfo::BERRIES[0]);
 
 // Valid berry item IDs for cycling in editor (0 = none)
-const uint16_t DonutInfo::VALID_BERRY_IDS[] = {
+constexpr uint16_t DonutInfo::VALID_BERRY_IDS[] = {
     0,
     149, 150, 151, 152, 153, 155, 156, 157, 158,
     169, 170, 171, 172, 173, 174,
@@ -136,10 +144,67 @@ const uint16_t DonutInfo::VALID_BERRY_IDS[] = {
     2679, 2680, 2681, 2682, 2683,
 };
 
-const int DonutInfo::VALID_BERRY_COUNT = sizeof(DonutInfo::VALID_BERRY_IDS) / sizeof(DonutInfo::VALID_BERRY_IDS[0]);
+constexpr int DonutInfo::VALID_BERRY_COUNT = sizeof(DonutInfo::VALID_BERRY_IDS) / sizeof(DonutInfo::VALID_BERRY_IDS[0]);
+
+// Berry names, parallel to BERRIES. Z-A names from text_Items_en.txt
+// (index N = display line N+1).
+static constexpr const char* BERRY_NAMES[] = {
+    "Cheri Berry", "Chesto Berry", "Pecha Berry", "Rawst Berry", "Aspear Berry",
+    "Oran Berry", "Persim Berry", "Lum Berry", "Sitrus Berry",
+    "Pomeg Berry", "Kelpsy Berry", "Qualot Berry", "Hondew Berry", "Grepa Berry", "Tamato Berry",
+    "Occa Berry", "Passho Berry", "Wacan Berry", "Rindo Berry", "Yache Berry", "Chople Berry",
+    "Kebia Berry", "Shuca Berry", "Coba Berry", "Payapa Berry", "Tanga Berry", "Charti Berry",
+    "Kasib Berry", "Haban Berry", "Colbur Berry", "Babiri Berry", "Chilan Berry",
+    "Roseli Berry",
+    "Hyper Cheri Berry", "Hyper Chesto Berry", "Hyper Pecha Berry", "Hyper Rawst Berry",
+    "Hyper Aspear Berry", "Hyper Oran Berry", "Hyper Persim Berry", "Hyper Lum Berry",
+    "Hyper Sitrus Berry", "Hyper Pomeg Berry", "Hyper Kelpsy Berry", "Hyper Qualot Berry",
+    "Hyper Hondew Berry", "Hyper Grepa Berry", "Hyper Tamato Berry", "Hyper Occa Berry",
+    "Hyper Passho Berry", "Hyper Wacan Berry", "Hyper Rindo Berry", "Hyper Yache Berry",
+    "Hyper Chople Berry", "Hyper Kebia Berry", "Hyper Shuca Berry", "Hyper Coba Berry",
+    "Hyper Payapa Berry", "Hyper Tanga Berry", "Hyper Charti Berry", "Hyper Kasib Berry",
+    "Hyper Haban Berry", "Hyper Colbur Berry", "Hyper Babiri Berry", "Hyper Chilan Berry",
+    "Hyper Roseli Berry",
+};
+static_assert(sizeof(BERRY_NAMES) / sizeof(BERRY_NAMES[0]) == DonutInfo::BERRY_COUNT);
+
+// Berry item IDs fall in two runs, 149-686 and 2651-2683. Packed back to
+// back they give a dense slot per possible berry item.
+static constexpr uint16_t BERRY_RUN1_FIRST = 149;
+static constexpr uint16_t BERRY_RUN1_LAST = 686;
+static constexpr uint16_t BERRY_RUN2_FIRST = 2651;
+static constexpr uint16_t BERRY_RUN2_LAST = 2683;
+static constexpr int BERRY_SLOT_COUNT =
+    (BERRY_RUN1_LAST - BERRY_RUN1_FIRST + 1) + (BERRY_RUN2_LAST - BERRY_RUN2_FIRST + 1);
+
+static constexpr int berrySlot(uint16_t item) {
+    if (item >= BERRY_RUN1_FIRST && item <= BERRY_RUN1_LAST)
+        return item - BERRY_RUN1_FIRST;
+    if (item >= BERRY_RUN2_FIRST && item <= BERRY_RUN2_LAST)
+        return (BERRY_RUN1_LAST - BERRY_RUN1_FIRST + 1) + (item - BERRY_RUN2_FIRST);
+    return -1;
+}
+
+struct BerrySlotTables {
+    uint8_t berry[BERRY_SLOT_COUNT]; // BERRIES index + 1, 0 = not a berry
+    uint8_t valid[BERRY_SLOT_COUNT]; // VALID_BERRY_IDS index, 0 = not listed
+};
+
+static constexpr BerrySlotTables buildBerrySlotTables() {
+    BerrySlotTables t{};
+    for (int i = 0; i < DonutInfo::BERRY_COUNT; i++)
+        t.berry[berrySlot(DonutInfo::BERRIES[i].item)] = static_cast<uint8_t>(i + 1);
+    for (int i = 1; i < DonutInfo::VALID_BERRY_COUNT; i++)
+        t.valid[berrySlot(DonutInfo::VALID_BERRY_IDS[i])] = static_cast<uint8_t>(i);
+    return t;
+}
+
+// A berry outside the two runs makes berrySlot() return -1 and fails the
+// build here.
+static constexpr BerrySlotTables BERRY_SLOTS = buildBerrySlotTables();
 
 // Flavor hash table — hashes from PKHeX.Core (FnvHash.HashFnv1a_64), display names from game text
-const FlavorEntry DonutInfo::FLAVORS[] = {
+constexpr FlavorEntry DonutInfo::FLAVORS[] = {
     {0, "(none)"},
     // Sweet — Alpha Power / Sparkling Power
     {0xCCFCBB9681D321F1, "Alpha Power (Lv. 1)"},
@@ -430,7 +495,127 @@ const FlavorEntry DonutInfo::FLAVORS[] = {
     {0x2E27B89C885F77BC, "Emerald-Green Power"},
 };
 
-const int DonutInfo::FLAVOR_COUNT = sizeof(DonutInfo::FLAVORS) / sizeof(DonutInfo::FLAVORS[0]);
+constexpr int DonutInfo::FLAVOR_COUNT = sizeof(DonutInfo::FLAVORS) / sizeof(DonutInfo::FLAVORS[0]);
+
+// Perfect hash over the flavor hashes, built at compile time (hash and
+// displace): a key's bucket picks a displacement, and the displaced key
+// lands in a slot no other key uses. Lookup is two table reads and one
+// compare against FLAVORS.
+static constexpr int FLAVOR_BUCKET_BITS = 7;
+static constexpr int FLAVOR_SLOT_BITS = 9;
+static constexpr int FLAVOR_BUCKETS = 1 << FLAVOR_BUCKET_BITS;
+static constexpr int FLAVOR_SLOTS = 1 << FLAVOR_SLOT_BITS;
+static_assert(DonutInfo::FLAVOR_COUNT < FLAVOR_SLOTS);
+
+static constexpr int flavorBucket(uint64_t hash) {
+    return static_cast<int>((hash * 0xD6E8FEB86659FD93ull) >> (64 - FLAVOR_BUCKET_BITS));
+}
+
+static constexpr int flavorSlot(uint64_t hash, uint16_t disp) {
+    uint64_t x = (hash ^ (disp * 0x9E3779B97F4A7C15ull)) * 0xBF58476D1CE4E5B9ull;
+    return static_cast<int>(x >> (64 - FLAVOR_SLOT_BITS));
+}
+
+struct FlavorPerfectHash {
+    uint16_t disp[FLAVOR_BUCKETS];
+    uint16_t slot[FLAVOR_SLOTS]; // FLAVORS index + 1, 0 = empty
+    bool ok;
+};
+
+static constexpr FlavorPerfectHash buildFlavorPerfectHash() {
+    FlavorPerfectHash t{};
+    int bucketSize[FLAVOR_BUCKETS] = {};
+    for (int i = 0; i < DonutInfo::FLAVOR_COUNT; i++)
+        bucketSize[flavorBucket(DonutInfo::FLAVORS[i].hash)]++;
+
+    // Place the fullest buckets first, while the table is still empty.
+    bool placed[FLAVOR_BUCKETS] = {};
+    for (int round = 0; round < FLAVOR_BUCKETS; round++) {
+        int b = -1;
+        for (int j = 0; j < FLAVOR_BUCKETS; j++) {
+            if (!placed[j] && (b < 0 || bucketSize[j] > bucketSize[b]))
+                b = j;
+        }
+        placed[b] = true;
+        if (bucketSize[b] == 0)
+            continue;
+
+        bool found = false;
+        for (int d = 0; d < 0x10000 && !found; d++) {
+            int used[FLAVOR_SLOTS / 32 + 1] = {};
+            found = true;
+            for (int i = 0; i < DonutInfo::FLAVOR_COUNT && found; i++) {
+                uint64_t h = DonutInfo::FLAVORS[i].hash;
+                if (flavorBucket(h) != b)
+                    continue;
+                int s = flavorSlot(h, static_cast<uint16_t>(d));
+                if (t.slot[s] != 0 || (used[s / 32] >> (s % 32) & 1))
+                    found = false;
+                used[s / 32] |= 1 << (s % 32);
+            }
+            if (!found)
+                continue;
+            t.disp[b] = static_cast<uint16_t>(d);
+            for (int i = 0; i < DonutInfo::FLAVOR_COUNT; i++) {
+                uint64_t h = DonutInfo::FLAVORS[i].hash;
+                if (flavorBucket(h) == b)
+                    t.slot[flavorSlot(h, t.disp[b])] = static_cast<uint16_t>(i + 1);
+            }
+        }
+        if (!found)
+            return t; // ok stays false, e.g. a duplicate hash in FLAVORS
+    }
+    t.ok = true;
+    return t;
+}
+
+static constexpr FlavorPerfectHash FLAVOR_HASH = buildFlavorPerfectHash();
+static_assert(FLAVOR_HASH.ok, "FLAVORS hashes must be unique");
+
+// Category IDs are prefix hashes; make sure no two prefixes collide.
+static constexpr bool flavorCategoriesDistinct() {
+    for (int i = 0; i < DonutInfo::FLAVOR_COUNT; i++) {
+        const FlavorEntry& a = DonutInfo::FLAVORS[i];
+        int lenA = FlavorEntry::categoryLen(a.name);
+        for (int j = i + 1; j < DonutInfo::FLAVOR_COUNT; j++) {
+            const FlavorEntry& b = DonutInfo::FLAVORS[j];
+            if (a.category != b.category)
+                continue;
+            if (FlavorEntry::categoryLen(b.name) != lenA)
+                return false;
+            for (int k = 0; k < lenA; k++)
+                if (a.name[k] != b.name[k]) return false;
+        }
+    }
+    return true;
+}
+static_assert(flavorCategoriesDistinct(), "FLAVORS category IDs collide");
+
+// FLAVORS indices at one level, optionally of one family, in table order.
+struct FlavorIndexList {
+    uint16_t idx[DonutInfo::FLAVOR_COUNT];
+    int count;
+};
+
+static constexpr FlavorIndexList buildFlavorIndexList(uint8_t level, bool anyFamily,
+                                                      FlavorFamily family = FlavorFamily::Other) {
+    FlavorIndexList l{};
+    for (int i = 1; i < DonutInfo::FLAVOR_COUNT; i++) {
+        const FlavorEntry& f = DonutInfo::FLAVORS[i];
+        if (f.level == level && (anyFamily || f.family == family))
+            l.idx[l.count++] = static_cast<uint16_t>(i);
+    }
+    return l;
+}
+
+static constexpr FlavorIndexList LV3_FLAVORS = buildFlavorIndexList(3, true);
+static constexpr FlavorIndexList SPARKLING_LV3 = buildFlavorIndexList(3, false, FlavorFamily::Sparkling);
+static constexpr FlavorIndexList CATCHING_LV3 = buildFlavorIndexList(3, false, FlavorFamily::Catching);
+static constexpr FlavorIndexList ALPHA_LV3 = buildFlavorIndexList(3, false, FlavorFamily::Alpha);
+static constexpr FlavorIndexList HUMUNGO_LV3 = buildFlavorIndexList(3, false, FlavorFamily::Humungo);
+static constexpr FlavorIndexList TEENSY_LV3 = buildFlavorIndexList(3, false, FlavorFamily::Teensy);
+static_assert(LV3_FLAVORS.count >= 3 && SPARKLING_LV3.count > 0 && CATCHING_LV3.count > 0);
+static_assert(ALPHA_LV3.count == 1 && HUMUNGO_LV3.count == 1 && TEENSY_LV3.count == 1);
 
 // Shiny template from PKHeX.Core DonutPocket9a.Template
 const uint8_t DonutInfo::SHINY_TEMPLATE[Donut9a::SIZE] = {
@@ -448,17 +633,14 @@ const uint8_t DonutInfo::SHINY_TEMPLATE[Donut9a::SIZE] = {
 // --- Lookup functions ---
 
 int DonutInfo::findBerryByItem(uint16_t item) {
-    for (int i = 0; i < BERRY_COUNT; i++) {
-        if (BERRIES[i].item == item) return i;
-    }
-    return -1;
+    int slot = berrySlot(item);
+    return slot < 0 ? -1 : BERRY_SLOTS.berry[slot] - 1;
 }
 
 int DonutInfo::findFlavorByHash(uint64_t hash) {
-    for (int i = 0; i < FLAVOR_COUNT; i++) {
-        if (FLAVORS[i].hash == hash) return i;
-    }
-    return -1;
+    int slot = flavorSlot(hash, FLAVOR_HASH.disp[flavorBucket(hash)]);
+    int idx = FLAVOR_HASH.slot[slot] - 1;
+    return idx >= 0 && FLAVORS[idx].hash == hash ? idx : -1;
 }
 
 const char* DonutInfo::getFlavorName(uint64_t hash) {
@@ -469,77 +651,9 @@ const char* DonutInfo::getFlavorName(uint64_t hash) {
 }
 
 const char* DonutInfo::getBerryName(uint16_t item) {
-    switch (item) {
-        case 0:    return "(none)";
-        case 149:  return "Cheri Berry";
-        case 150:  return "Chesto Berry";
-        case 151:  return "Pecha Berry";
-        case 152:  return "Rawst Berry";
-        case 153:  return "Aspear Berry";
-        case 155:  return "Oran Berry";
-        case 156:  return "Persim Berry";
-        case 157:  return "Lum Berry";
-        case 158:  return "Sitrus Berry";
-        case 169:  return "Pomeg Berry";
-        case 170:  return "Kelpsy Berry";
-        case 171:  return "Qualot Berry";
-        case 172:  return "Hondew Berry";
-        case 173:  return "Grepa Berry";
-        case 174:  return "Tamato Berry";
-        case 184:  return "Occa Berry";
-        case 185:  return "Passho Berry";
-        case 186:  return "Wacan Berry";
-        case 187:  return "Rindo Berry";
-        case 188:  return "Yache Berry";
-        case 189:  return "Chople Berry";
-        case 190:  return "Kebia Berry";
-        case 191:  return "Shuca Berry";
-        case 192:  return "Coba Berry";
-        case 193:  return "Payapa Berry";
-        case 194:  return "Tanga Berry";
-        case 195:  return "Charti Berry";
-        case 196:  return "Kasib Berry";
-        case 197:  return "Haban Berry";
-        case 198:  return "Colbur Berry";
-        case 199:  return "Babiri Berry";
-        case 200:  return "Chilan Berry";
-        case 686:  return "Roseli Berry";
-        // Z-A berries (item IDs 2651-2683, names from text_Items_en.txt index N = display line N+1)
-        case 2651: return "Hyper Cheri Berry";
-        case 2652: return "Hyper Chesto Berry";
-        case 2653: return "Hyper Pecha Berry";
-        case 2654: return "Hyper Rawst Berry";
-        case 2655: return "Hyper Aspear Berry";
-        case 2656: return "Hyper Oran Berry";
-        case 2657: return "Hyper Persim Berry";
-        case 2658: return "Hyper Lum Berry";
-        case 2659: return "Hyper Sitrus Berry";
-        case 2660: return "Hyper Pomeg Berry";
-        case 2661: return "Hyper Kelpsy Berry";
-        case 2662: return "Hyper Qualot Berry";
-        case 2663: return "Hyper Hondew Berry";
-        case 2664: return "Hyper Grepa Berry";
-        case 2665: return "Hyper Tamato Berry";
-        case 2666: return "Hyper Occa Berry";
-        case 2667: return "Hyper Passho Berry";
-        case 2668: return "Hyper Wacan Berry";
-        case 2669: return "Hyper Rindo Berry";
-        case 2670: return "Hyper Yache Berry";
-        case 2671: return "Hyper Chople Berry";
-        case 2672: return "Hyper Kebia Berry";
-        case 2673: return "Hyper Shuca Berry";
-        case 2674: return "Hyper Coba Berry";
-        case 2675: return "Hyper Payapa Berry";
-        case 2676: return "Hyper Tanga Berry";
-        case 2677: return "Hyper Charti Berry";
-        case 2678: return "Hyper Kasib Berry";
-        case 2679: return "Hyper Haban Berry";
-        case 2680: return "Hyper Colbur Berry";
-        case 2681: return "Hyper Babiri Berry";
-        case 2682: return "Hyper Chilan Berry";
-        case 2683: return "Hyper Roseli Berry";
-        default:   return "???";
-    }
+    if (item == 0) return "(none)";
+    int idx = findBerryByItem(item);
+    return idx >= 0 ? BERRY_NAMES[idx] : "???";
 }
 
 uint8_t DonutInfo::calcStarRating(int flavorScore) {
@@ -552,10 +666,8 @@ uint8_t DonutInfo::calcStarRating(int flavorScore) {
 }
 
 int DonutInfo::findValidBerryIndex(uint16_t item) {
-    for (int i = 0; i < VALID_BERRY_COUNT; i++) {
-        if (VALID_BERRY_IDS[i] == item) return i;
-    }
-    return 0;
+    int slot = berrySlot(item);
+    return slot < 0 ? 0 : BERRY_SLOTS.valid[slot];
 }
 
 std::string DonutInfo::starsString(uint8_t count) {
@@ -571,96 +683,65 @@ std::string DonutInfo::starsString(uint8_t count) {
 
 // --- Batch operations ---
 
-// Collect all lv3 flavor indices for random fill
-static void getLv3FlavorIndices(int* out, int& count) {
-    count = 0;
-    for (int i = 1; i < DonutInfo::FLAVOR_COUNT; i++) {
-        const char* name = DonutInfo::FLAVORS[i].name;
-        int len = 0;
-        while (name[len]) len++;
-        // Check for "(Lv. 3)" at end
-        if (len >= 7 &&
-            name[len-7] == '(' && name[len-6] == 'L' && name[len-5] == 'v' &&
-            name[len-4] == '.' && name[len-3] == ' ' && name[len-2] == '3' &&
-            name[len-1] == ')')
-            out[count++] = i;
+// Randomize flavors like PKHeX's ApplyShinySizeCatch
+static void setShinyRandomFlavors(Donut9a& d) {
+    d.setFlavor(0, DonutInfo::FLAVORS[SPARKLING_LV3.idx[nextRand() % SPARKLING_LV3.count]].hash);
+    int roll = nextRand() % 3;
+    const FlavorIndexList& size = roll == 0 ? HUMUNGO_LV3 : roll == 1 ? TEENSY_LV3 : ALPHA_LV3;
+    d.setFlavor(1, DonutInfo::FLAVORS[size.idx[0]].hash);
+    d.setFlavor(2, DonutInfo::FLAVORS[CATCHING_LV3.idx[nextRand() % CATCHING_LV3.count]].hash);
+}
+
+// Stamps d with the current time, moved on a millisecond at a time until
+// no other slot of the pocket holds it, so fills of several slots in the
+// same second still get distinct timestamps. Without a pocket the time is
+// taken as is.
+static void applyUniqueTimestamp(Donut9a& d, const uint8_t* blockData) {
+    for (int bias = 0;; bias++) {
+        d.applyTimestamp(bias);
+        if (!blockData)
+            return;
+        uint64_t ts = d.millisecondsSince1970();
+        bool taken = false;
+        for (int i = 0; i < Donut9a::MAX_COUNT && !taken; i++) {
+            const uint8_t* slot = blockData + i * Donut9a::SIZE;
+            taken = slot != d.data && std::memcmp(slot, &ts, 8) == 0;
+        }
+        if (!taken)
+            return;
     }
 }
 
-void DonutInfo::fillOneShiny(Donut9a& d) {
+void DonutInfo::fillOneShiny(Donut9a& d, const uint8_t* blockData) {
     std::memcpy(d.data, SHINY_TEMPLATE, Donut9a::SIZE);
-    d.applyTimestamp();
+    applyUniqueTimestamp(d, blockData);
     recalcStats(d);
     d.setFlavor(0, 0xD373B22CEF7A33C9ULL); // Sparkling Power: All Types (Lv. 3)
     d.setFlavor(1, 0xCCFCB99681D31E8BULL); // Alpha Power (Lv. 3)
     d.setFlavor(2, 0);
 }
 
-void DonutInfo::fillOneShinyRandom(Donut9a& d) {
+void DonutInfo::fillOneShinyRandom(Donut9a& d, const uint8_t* blockData) {
     seedRand();
     std::memcpy(d.data, SHINY_TEMPLATE, Donut9a::SIZE);
-    d.applyTimestamp();
+    applyUniqueTimestamp(d, blockData);
     recalcStats(d);
-
-    int sparkLv3[32]; int sparkCount = 0;
-    for (int i = 1; i < FLAVOR_COUNT; i++) {
-        const char* n = FLAVORS[i].name;
-        if (n[0] == 'S' && n[1] == 'p' && n[2] == 'a' && n[3] == 'r') {
-            int len = 0; while (n[len]) len++;
-            if (len >= 7 && n[len-2] == '3')
-                sparkLv3[sparkCount++] = i;
-        }
-    }
-
-    int humungoIdx = findFlavorByHash(0xCF24AEDFA2D0FCAB);
-    int teensyIdx  = findFlavorByHash(0xADCF1EA0D67FA02E);
-    int alphaIdx   = findFlavorByHash(0xCCFCB99681D31E8B);
-
-    int catchLv3[32]; int catchCount = 0;
-    for (int i = 1; i < FLAVOR_COUNT; i++) {
-        const char* n = FLAVORS[i].name;
-        if (n[0] == 'C' && n[1] == 'a' && n[2] == 't' && n[3] == 'c') {
-            int len = 0; while (n[len]) len++;
-            if (len >= 7 && n[len-2] == '3')
-                catchLv3[catchCount++] = i;
-        }
-    }
-
-    if (sparkCount > 0)
-        d.setFlavor(0, FLAVORS[sparkLv3[nextRand() % sparkCount]].hash);
-    int roll = nextRand() % 3;
-    if (roll == 0 && humungoIdx >= 0)
-        d.setFlavor(1, FLAVORS[humungoIdx].hash);
-    else if (roll == 1 && teensyIdx >= 0)
-        d.setFlavor(1, FLAVORS[teensyIdx].hash);
-    else if (alphaIdx >= 0)
-        d.setFlavor(1, FLAVORS[alphaIdx].hash);
-    if (catchCount > 0)
-        d.setFlavor(2, FLAVORS[catchLv3[nextRand() % catchCount]].hash);
-}
-
-// Compare flavor category (prefix before ": " or " (")
-static bool sameCategory(int idxA, int idxB) {
-    const char* a = DonutInfo::FLAVORS[idxA].name;
-    const char* b = DonutInfo::FLAVORS[idxB].name;
-    int lenA = 0;
-    while (a[lenA] && !(a[lenA] == ':' && a[lenA+1] == ' ') && !(a[lenA] == ' ' && a[lenA+1] == '(')) lenA++;
-    int lenB = 0;
-    while (b[lenB] && !(b[lenB] == ':' && b[lenB+1] == ' ') && !(b[lenB] == ' ' && b[lenB+1] == '(')) lenB++;
-    if (lenA != lenB) return false;
-    for (int i = 0; i < lenA; i++) if (a[i] != b[i]) return false;
-    return true;
+    setShinyRandomFlavors(d);
 }
 
 // Pick 3 distinct Lv3 flavors, each from a different category
-static void pickRandomLv3Flavors(const int* lv3Indices, int lv3Count, uint64_t out[3]) {
+static void pickRandomLv3Flavors(uint64_t out[3]) {
     int picks[3] = {-1, -1, -1};
     for (int p = 0; p < 3; p++) {
         for (;;) {
-            int idx = lv3Indices[nextRand() % lv3Count];
+            int idx = LV3_FLAVORS.idx[nextRand() % LV3_FLAVORS.count];
             bool conflict = false;
             for (int q = 0; q < p; q++) {
-                if (picks[q] == idx || sameCategory(picks[q], idx)) { conflict = true; break; }
+                // Same index implies same category.
+                if (DonutInfo::FLAVORS[picks[q]].category == DonutInfo::FLAVORS[idx].category) {
+                    conflict = true;
+                    break;
+                }
             }
             if (conflict) continue;
             picks[p] = idx;
@@ -671,12 +752,8 @@ static void pickRandomLv3Flavors(const int* lv3Indices, int lv3Count, uint64_t o
         out[i] = DonutInfo::FLAVORS[picks[i]].hash;
 }
 
-void DonutInfo::fillOneRandomLv3(Donut9a& d) {
+void DonutInfo::fillOneRandomLv3(Donut9a& d, const uint8_t* blockData) {
     seedRand();
-    int lv3Indices[512]; int lv3Count = 0;
-    getLv3FlavorIndices(lv3Indices, lv3Count);
-    if (lv3Count < 3) return;
-
     d.clear();
     // Randomize 8 berries (skip index 0 = none)
     for (int i = 0; i < Donut9a::MAX_BERRIES; i++)
@@ -684,81 +761,29 @@ void DonutInfo::fillOneRandomLv3(Donut9a& d) {
     recalcStats(d);
 
     uint64_t flavors[3];
-    pickRandomLv3Flavors(lv3Indices, lv3Count, flavors);
+    pickRandomLv3Flavors(flavors);
     d.setFlavor(0, flavors[0]);
     d.setFlavor(1, flavors[1]);
     d.setFlavor(2, flavors[2]);
 
-    d.applyTimestamp();
+    applyUniqueTimestamp(d, blockData);
 }
 
 void DonutInfo::fillAllShiny(uint8_t* blockData) {
     seedRand();
-    // Collect Sparkling Power lv3 indices for flavor0
-    int sparkLv3[32];
-    int sparkCount = 0;
-    for (int i = 1; i < FLAVOR_COUNT; i++) {
-        const char* n = FLAVORS[i].name;
-        // Match "Sparkling Power: * (Lv. 3)" but not "Alpha Power"
-        if (n[0] == 'S' && n[1] == 'p' && n[2] == 'a' && n[3] == 'r') {
-            int len = 0; while (n[len]) len++;
-            if (len >= 7 && n[len-2] == '3')
-                sparkLv3[sparkCount++] = i;
-        }
-    }
-
-    // Find Humungo Power (Lv. 3) and Teensy Power (Lv. 3) and Alpha Power (Lv. 3)
-    int humungoIdx = findFlavorByHash(0xCF24AEDFA2D0FCAB); // Humungo Power (Lv. 3)
-    int teensyIdx  = findFlavorByHash(0xADCF1EA0D67FA02E); // Teensy Power (Lv. 3)
-    int alphaIdx   = findFlavorByHash(0xCCFCB99681D31E8B); // Alpha Power (Lv. 3)
-
-    // Collect Catching Power lv3 indices for flavor2
-    int catchLv3[32];
-    int catchCount = 0;
-    for (int i = 1; i < FLAVOR_COUNT; i++) {
-        const char* n = FLAVORS[i].name;
-        // Match "Catching Power: * (Lv. 3)" but skip Humungo/Teensy/Encounter
-        if (n[0] == 'C' && n[1] == 'a' && n[2] == 't' && n[3] == 'c') {
-            int len = 0; while (n[len]) len++;
-            if (len >= 7 && n[len-2] == '3')
-                catchLv3[catchCount++] = i;
-        }
-    }
-
     for (int i = 0; i < Donut9a::MAX_COUNT; i++) {
         uint8_t* entry = blockData + i * Donut9a::SIZE;
         std::memcpy(entry, SHINY_TEMPLATE, Donut9a::SIZE);
 
         Donut9a d{entry};
-
-        recalcStats(d);
-
-        // Randomize flavors like PKHeX's ApplyShinySizeCatch
-        if (sparkCount > 0)
-            d.setFlavor(0, FLAVORS[sparkLv3[nextRand() % sparkCount]].hash);
-
-        int roll = nextRand() % 3;
-        if (roll == 0 && humungoIdx >= 0)
-            d.setFlavor(1, FLAVORS[humungoIdx].hash);
-        else if (roll == 1 && teensyIdx >= 0)
-            d.setFlavor(1, FLAVORS[teensyIdx].hash);
-        else if (alphaIdx >= 0)
-            d.setFlavor(1, FLAVORS[alphaIdx].hash);
-
-        if (catchCount > 0)
-            d.setFlavor(2, FLAVORS[catchLv3[nextRand() % catchCount]].hash);
-
+        setShinyRandomFlavors(d);
         d.applyTimestamp(i);
     }
+    recalcAll(blockData);
 }
 
 void DonutInfo::fillAllRandomLv3(uint8_t* blockData) {
     seedRand();
-    int lv3Indices[512];
-    int lv3Count = 0;
-    getLv3FlavorIndices(lv3Indices, lv3Count);
-    if (lv3Count < 3) return;
-
     for (int i = 0; i < Donut9a::MAX_COUNT; i++) {
         uint8_t* entry = blockData + i * Donut9a::SIZE;
         std::memset(entry, 0, Donut9a::SIZE);
@@ -767,14 +792,14 @@ void DonutInfo::fillAllRandomLv3(uint8_t* blockData) {
         // Randomize 8 berries (skip index 0 = none)
         for (int j = 0; j < Donut9a::MAX_BERRIES; j++)
             d.setBerry(j, VALID_BERRY_IDS[1 + nextRand() % (VALID_BERRY_COUNT - 1)]);
-        recalcStats(d);
         uint64_t flavors[3];
-        pickRandomLv3Flavors(lv3Indices, lv3Count, flavors);
+        pickRandomLv3Flavors(flavors);
         d.setFlavor(0, flavors[0]);
         d.setFlavor(1, flavors[1]);
         d.setFlavor(2, flavors[2]);
         d.applyTimestamp(i);
     }
+    recalcAll(blockData);
 }
 
 void DonutInfo::compress(uint8_t* blockData) {
@@ -891,3 +916,231 @@ void DonutInfo::recalcStats(Donut9a& d) {
         d.setDonutSprite(static_cast<uint16_t>(donutIdx * 6 + variant));
     }
 }
+
+// --- Batch stats ---
+
+// Berry attributes packed four 16-bit fields to a word, so a donut's eight
+// berries sum with two adds per berry; no field can carry (8 * 255 and
+// 8 * max calories both fit in 16 bits). Indexed by BERRY_SLOTS.berry
+// value (BERRIES index + 1); row 0 stands for "not a berry" and adds 0.
+struct BerryRows {
+    uint64_t flavorWord[DonutInfo::BERRY_COUNT + 1]; // spicy, fresh, sweet, bitter
+    uint64_t statWord[DonutInfo::BERRY_COUNT + 1];   // sour, boost, calories
+};
+
+static constexpr BerryRows buildBerryRows() {
+    BerryRows t{};
+    for (int i = 0; i < DonutInfo::BERRY_COUNT; i++) {
+        const BerryDetail& b = DonutInfo::BERRIES[i];
+        t.flavorWord[i + 1] = uint64_t(b.spicy) | uint64_t(b.fresh) << 16 |
+                              uint64_t(b.sweet) << 32 | uint64_t(b.bitter) << 48;
+        t.statWord[i + 1] = uint64_t(b.sour) | uint64_t(b.boost) << 16 |
+                            uint64_t(b.calories) << 32;
+    }
+    return t;
+}
+
+static constexpr BerryRows BERRY_ROWS = buildBerryRows();
+static_assert([] {
+    int maxCal = 0;
+    for (int i = 0; i < DonutInfo::BERRY_COUNT; i++)
+        maxCal = DonutInfo::BERRIES[i].calories > maxCal ? DonutInfo::BERRIES[i].calories : maxCal;
+    return maxCal * Donut9a::MAX_BERRIES <= 0xFFFF;
+}(), "calorie sums must fit a 16-bit field");
+
+static constexpr int RECALC_LANES = 64;
+
+// A batch of donuts in structure-of-arrays form, one lane per donut.
+struct RecalcBatch {
+    uint32_t flavor[5][RECALC_LANES]; // calcFlavorProfile order
+    uint32_t boost[RECALC_LANES];
+    uint32_t calories[RECALC_LANES];
+    uint32_t stars[RECALC_LANES];
+    uint32_t variant[RECALC_LANES];
+};
+
+static inline uint8_t berryRow(uint16_t item) {
+    int slot = berrySlot(item);
+    return slot < 0 ? 0 : BERRY_SLOTS.berry[slot];
+}
+
+// recalcStats on the summed lanes. Selects are written as mask arithmetic
+// so the loop has no control flow and the compiler can vectorize it.
+static void recalcBatch(RecalcBatch& b) {
+    for (int l = 0; l < RECALC_LANES; l++) {
+        uint32_t f0 = b.flavor[0][l], f1 = b.flavor[1][l], f2 = b.flavor[2][l];
+        uint32_t f3 = b.flavor[3][l], f4 = b.flavor[4][l];
+        uint32_t score = f0 + f1 + f2 + f3 + f4;
+        // calcStarRating as a sum of threshold compares
+        uint32_t stars = (score >= 120) + (score >= 240) + (score >= 360) +
+                         (score >= 700) + (score >= 960);
+        uint32_t mult = 10 + stars;
+        uint32_t cal = b.calories[l] * mult / 10;
+        b.calories[l] = cal > 9999 ? 9999 : cal;
+        b.boost[l] = b.boost[l] * mult / 10;
+        b.stars[l] = stars;
+
+        uint32_t maxVal = f0 > f1 ? f0 : f1;
+        maxVal = maxVal > f2 ? maxVal : f2;
+        maxVal = maxVal > f3 ? maxVal : f3;
+        maxVal = maxVal > f4 ? maxVal : f4;
+        uint32_t e0 = f0 == maxVal, e1 = f1 == maxVal, e2 = f2 == maxVal;
+        uint32_t e3 = f3 == maxVal, e4 = f4 == maxVal;
+        uint32_t count = e0 + e1 + e2 + e3 + e4;
+        // First dominant flavor: spicy→1, fresh→4, sweet→0, bitter→3, sour→2
+        uint32_t single = e0 * 1 + (e1 & ~e0) * 4 + (e3 & ~(e0 | e1 | e2)) * 3 +
+                          (e4 & ~(e0 | e1 | e2 | e3)) * 2;
+        uint32_t mix = count > 1;
+        b.variant[l] = (maxVal != 0) * (mix * 5 + (1 - mix) * single);
+    }
+}
+
+// Sums d's berries into the given lane. False if any berry is not a known
+// berry (it adds nothing, as in recalcStats).
+static inline bool gatherLane(RecalcBatch& b, int lane, const Donut9a& d) {
+    uint64_t fw = 0, sw = 0;
+    bool known = true;
+    for (int j = 0; j < Donut9a::MAX_BERRIES; j++) {
+        uint16_t item = d.berry(j);
+        uint8_t row = berryRow(item);
+        known &= row != 0 || item == 0;
+        fw += BERRY_ROWS.flavorWord[row];
+        sw += BERRY_ROWS.statWord[row];
+    }
+    b.flavor[0][lane] = fw & 0xFFFF;
+    b.flavor[1][lane] = fw >> 16 & 0xFFFF;
+    b.flavor[2][lane] = fw >> 32 & 0xFFFF;
+    b.flavor[3][lane] = fw >> 48;
+    b.flavor[4][lane] = sw & 0xFFFF;
+    b.boost[lane] = sw >> 16 & 0xFFFF;
+    b.calories[lane] = sw >> 32 & 0xFFFF;
+    return known;
+}
+
+void DonutInfo::recalcAll(uint8_t* blockData, const bool* selected) {
+    // Lanes past the last donut of a batch hold stale sums; their results
+    // are computed and dropped.
+    RecalcBatch batch{};
+    int slots[RECALC_LANES];
+    int i = 0;
+    while (i < Donut9a::MAX_COUNT) {
+        int n = 0;
+        for (; i < Donut9a::MAX_COUNT && n < RECALC_LANES; i++) {
+            if (selected && !selected[i])
+                continue;
+            gatherLane(batch, n, Donut9a{blockData + i * Donut9a::SIZE});
+            slots[n++] = i;
+        }
+        if (n == 0)
+            break;
+
+        recalcBatch(batch);
+
+        for (int l = 0; l < n; l++) {
+            Donut9a d{blockData + slots[l] * Donut9a::SIZE};
+            d.setCalories(static_cast<uint16_t>(batch.calories[l]));
+            d.setLevelBoost(static_cast<uint8_t>(batch.boost[l]));
+            d.setStars(static_cast<uint8_t>(batch.stars[l]));
+            d.setBerryName(d.berry(0));
+            int berryIdx = findBerryByItem(d.berry(0));
+            if (berryIdx >= 0)
+                d.setDonutSprite(static_cast<uint16_t>(BERRIES[berryIdx].donutIdx * 6 + batch.variant[l]));
+        }
+    }
+}
+
+// --- Legality audit ---
+
+// packDateTime1900 with the local-time conversion cached per minute. Zone
+// offsets are whole minutes, so within a minute only the seconds byte
+// changes; a minute that doesn't start at second 0 isn't cached.
+struct DateTime1900Cache {
+    uint64_t minute = UINT64_MAX;
+    uint8_t packed[8] = {};
+    bool valid = false;
+
+    bool pack(uint64_t ms, uint8_t out[8]) {
+        uint64_t secs = ms / 1000;
+        if (secs / 60 != minute) {
+            minute = secs / 60;
+            valid = packDateTime1900(minute * 60000, packed) && packed[4] == 0;
+        }
+        if (!valid)
+            return packDateTime1900(ms, out);
+        std::memcpy(out, packed, sizeof(packed));
+        out[4] = static_cast<uint8_t>(secs % 60);
+        return true;
+    }
+};
+
+void DonutInfo::auditPocket(const uint8_t* blockData, uint8_t* issues, const bool* dirty) {
+    // Per-slot checks, with the stat checks batched through recalcBatch.
+    RecalcBatch batch{};
+    DateTime1900Cache dateTimes;
+    int slots[RECALC_LANES];
+    int i = 0;
+    while (i < Donut9a::MAX_COUNT) {
+        int n = 0;
+        for (; i < Donut9a::MAX_COUNT && n < RECALC_LANES; i++) {
+            if (dirty && !dirty[i])
+                continue;
+            issues[i] = 0;
+            const Donut9a d{const_cast<uint8_t*>(blockData + i * Donut9a::SIZE)};
+            if (d.isEmpty())
+                continue;
+
+            if (!gatherLane(batch, n, d))
+                issues[i] |= DonutIssue::BadBerry;
+            for (int f = 0; f < Donut9a::MAX_FLAVORS; f++) {
+                uint64_t fh = d.flavor(f);
+                if (fh != 0 && findFlavorByHash(fh) < 0)
+                    issues[i] |= DonutIssue::BadFlavor;
+            }
+            uint8_t dt[8];
+            if (!dateTimes.pack(d.millisecondsSince1970(), dt) ||
+                std::memcmp(d.data + 0x20, dt, sizeof(dt)) != 0)
+                issues[i] |= DonutIssue::BadDateTime;
+            uint64_t reserved;
+            std::memcpy(&reserved, d.data + 0x40, 8);
+            if (reserved != 0)
+                issues[i] |= DonutIssue::Reserved;
+            slots[n++] = i;
+        }
+        if (n == 0)
+            break;
+
+        recalcBatch(batch);
+
+        for (int l = 0; l < n; l++) {
+            const Donut9a d{const_cast<uint8_t*>(blockData + slots[l] * Donut9a::SIZE)};
+            bool same = d.calories() == batch.calories[l] &&
+                        d.levelBoost() == static_cast<uint8_t>(batch.boost[l]) &&
+                        d.stars() == batch.stars[l] &&
+                        d.berryName() == d.berry(0);
+            int berryIdx = findBerryByItem(d.berry(0));
+            if (berryIdx >= 0)
+                same &= d.donutSprite() == BERRIES[berryIdx].donutIdx * 6 + batch.variant[l];
+            if (!same)
+                issues[slots[l]] |= DonutIssue::StatMismatch;
+        }
+    }
+
+    // A timestamp is duplicated by a slot anywhere in the pocket, so this
+    // is redone in full: sort the stamps and flag equal neighbours.
+    std::pair<uint64_t, int> stamps[Donut9a::MAX_COUNT];
+    int count = 0;
+    for (int s = 0; s < Donut9a::MAX_COUNT; s++) {
+        issues[s] &= ~DonutIssue::DupTimestamp;
+        uint64_t ts;
+        std::memcpy(&ts, blockData + s * Donut9a::SIZE, 8);
+        if (ts != 0)
+            stamps[count++] = {ts, s};
+    }
+    std::sort(stamps, stamps + count);
+    for (int k = 1; k < count; k++) {
+        if (stamps[k].first == stamps[k - 1].first) {
+            issues[stamps[k].second] |= DonutIssue::DupTimestamp;
+            issues[stamps[k - 1].second] |= DonutIssue::DupTimestamp;
+        }
+    }
+}
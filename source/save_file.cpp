@@ -1,35 +1,69 @@
 #include "save_file.h"
+#include "sha256.h"
+#include "save_patch.h"
 #include <fstream>
 #include <cstring>
 #include <cstdio>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
 
 void SaveFile::setGameType(GameType game) {
     gameType_ = game;
 }
 
 bool SaveFile::load(const std::string& path) {
-    std::ifstream file(path, std::ios::binary | std::ios::ate);
-    if (!file.is_open())
-        return false;
+    waitVerify();
+    verifyPending_ = false;
 
-    auto fileSize = static_cast<size_t>(file.tellg());
-    file.seekg(0);
+    // Drop the previous save (image and payload arena) before reading the
+    // next, so the two are never resident together.
+    blocks_ = SCBlockStore{};
+    donutBlock_ = nullptr;
+    donutData_ = nullptr;
+    donutDataLen_ = 0;
+    savedDonuts_.reset();
+    loadedDonuts_.reset();
+    unwrittenRanges_.clear();
+    diskPath_.clear();
+    loaded_ = false;
 
-    std::vector<uint8_t> fileData(fileSize);
-    file.read(reinterpret_cast<char*>(fileData.data()), fileSize);
-    file.close();
+    // Map the file where possible so only the pages actually read (block
+    // headers and the donut block) are faulted in; otherwise read it all.
+    SCImage image;
+    if (!image.mapFile(path)) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+            return false;
 
-    // Keep original for round-trip verification
-    originalFileData_ = fileData;
+        auto fileSize = static_cast<size_t>(file.tellg());
+        file.seekg(0);
 
-    blocks_ = SwishCrypto::decrypt(fileData.data(), fileData.size());
+        std::vector<uint8_t> fileData(fileSize);
+        file.read(reinterpret_cast<char*>(fileData.data()), fileSize);
+        file.close();
+        image = SCImage(std::move(fileData));
+    }
+    fileSize_ = image.size();
+    fileDigestValid_ = false;
+
+    // Only the donut block is ever edited; leave the rest encrypted.
+    blocks_ = SwishCrypto::decrypt(std::move(image), SwishCrypto::DecryptMode::Lazy);
+    if (blocks_.blocks.empty())
+        return false;
+    cachedDonutCount_ = -1;
 
-    SCBlock* donutBlock = SwishCrypto::findBlock(blocks_, KDONUTS);
-    if (donutBlock) {
-        donutData_ = donutBlock->data.data();
-        donutDataLen_ = donutBlock->data.size();
+    donutBlock_ = SwishCrypto::findBlock(blocks_, KDONUTS);
+    if (donutBlock_) {
+        donutData_ = blocks_.data(*donutBlock_);
+        donutDataLen_ = donutBlock_->dataLen;
+        savedDonuts_.reset(new uint8_t[donutDataLen_]);
+        std::memcpy(savedDonuts_.get(), donutData_, donutDataLen_);
+        loadedDonuts_.reset(new uint8_t[donutDataLen_]);
+        std::memcpy(loadedDonuts_.get(), donutData_, donutDataLen_);
     }
 
+    diskPath_ = path;
     loaded_ = true;
     return true;
 }
@@ -37,8 +71,46 @@ bool SaveFile::load(const std::string& path) {
 bool SaveFile::save(const std::string& path) {
     if (!loaded_)
         return false;
+    if (path == diskPath_ && !hasUnsavedChanges())
+        return true;
+    waitVerify();
 
-    std::vector<uint8_t> encrypted = SwishCrypto::encrypt(blocks_);
+    // The donut block is handed out as a raw pointer, so edits are found by
+    // comparing each slot with the last saved copy. Changed slots are
+    // re-encrypted into the image in place; everything else, including the
+    // rest of the donut block, keeps its ciphertext.
+    if (donutBlock_) {
+        // A failed patch stops the loop, but the slots already patched still
+        // get their hash refreshed so the image stays consistent.
+        bool patched = true;
+        size_t firstChanged = SIZE_MAX;
+        for (size_t pos = 0; pos < donutDataLen_; pos += Donut9a::SIZE) {
+            size_t len = std::min<size_t>(Donut9a::SIZE, donutDataLen_ - pos);
+            if (std::memcmp(donutData_ + pos, savedDonuts_.get() + pos, len) == 0)
+                continue;
+            if (!SwishCrypto::patchImage(blocks_, *donutBlock_, pos, len)) {
+                patched = false;
+                break;
+            }
+            std::memcpy(savedDonuts_.get() + pos, donutData_ + pos, len);
+            firstChanged = std::min(firstChanged, donutBlock_->dataOffset + pos);
+            markUnwritten(donutBlock_->dataOffset + pos, len);
+        }
+        if (firstChanged != SIZE_MAX) {
+            SwishCrypto::refreshImageHash(blocks_, firstChanged);
+            markUnwritten(blocks_.image.size() - SwishCrypto::SIZE_HASH, SwishCrypto::SIZE_HASH);
+            fileDigestValid_ = false;
+        }
+        if (!patched)
+            return false;
+    }
+    const SCImage& encrypted = blocks_.image;
+
+    // The file we loaded only needs the patched ranges rewritten; any other
+    // target gets the whole image.
+    bool patchInPlace = path == diskPath_;
+    if (patchInPlace && unwrittenRanges_.empty())
+        return true;
 
     // Open for in-place writing (r+b) to avoid truncating the file.
     // The Switch save filesystem journal can break if we truncate + rewrite.
@@ -47,41 +119,209 @@ bool SaveFile::save(const std::string& path) {
     if (!f) {
         // File doesn't exist yet - create it
         f = std::fopen(path.c_str(), "wb");
+        patchInPlace = false;
     }
     if (!f)
         return false;
 
-    size_t written = std::fwrite(encrypted.data(), 1, encrypted.size(), f);
-    std::fclose(f);
-    return written == encrypted.size();
+    bool ok = true;
+    if (patchInPlace) {
+        std::sort(unwrittenRanges_.begin(), unwrittenRanges_.end());
+        for (const auto& [offset, len] : unwrittenRanges_) {
+            ok = std::fseek(f, static_cast<long>(offset), SEEK_SET) == 0 &&
+                 std::fwrite(encrypted.data() + offset, 1, len, f) == len;
+            if (!ok)
+                break;
+        }
+    } else {
+        ok = std::fwrite(encrypted.data(), 1, encrypted.size(), f) == encrypted.size();
+    }
+    ok = std::fclose(f) == 0 && ok;
+
+    // On failure the ranges stay pending, so the next save retries them.
+    if (ok && path == diskPath_)
+        unwrittenRanges_.clear();
+    return ok;
 }
 
-std::string SaveFile::verifyRoundTrip() {
-    if (originalFileData_.empty())
-        return "No original data to verify";
+bool SaveFile::exportPatch(const std::string& path) const {
+    if (!loaded_)
+        return false;
+
+    std::vector<SavePatch::Entry> entries;
+    if (donutBlock_)
+        SavePatch::diff(entries, KDONUTS, loadedDonuts_.get(), donutData_, donutDataLen_);
+    std::vector<uint8_t> patch = SavePatch::serialize(entries);
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = std::fwrite(patch.data(), 1, patch.size(), f) == patch.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+bool SaveFile::applyPatch(const std::string& path) {
+    if (!loaded_)
+        return false;
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return false;
+    auto size = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+    std::vector<uint8_t> patch(size);
+    if (!file.read(reinterpret_cast<char*>(patch.data()), size))
+        return false;
 
-    std::vector<uint8_t> reEncrypted = SwishCrypto::encrypt(blocks_);
+    std::vector<SavePatch::Entry> entries;
+    if (!SavePatch::parse(patch.data(), patch.size(), entries))
+        return false;
+    for (const auto& e : entries) {
+        const SCBlock* b = SwishCrypto::findBlock(blocks_, e.key);
+        if (!b || e.offset > b->dataLen || e.bytes.size() > b->dataLen - e.offset)
+            return false;
+    }
+
+    waitVerify();
+    // Donut edits go through the live donut buffer like any UI edit. Other
+    // blocks are re-encrypted into the image here and written by save(). As
+    // in save(), a failed patch still leaves the image hash refreshed for
+    // the entries before it.
+    bool patched = true;
+    size_t firstPatched = SIZE_MAX;
+    for (const auto& e : entries) {
+        SCBlock* b = SwishCrypto::findBlock(blocks_, e.key);
+        std::memcpy(blocks_.data(*b) + e.offset, e.bytes.data(), e.bytes.size());
+        if (b == donutBlock_)
+            continue;
+        if (!SwishCrypto::patchImage(blocks_, *b, e.offset, e.bytes.size())) {
+            patched = false;
+            break;
+        }
+        markUnwritten(b->dataOffset + e.offset, e.bytes.size());
+        firstPatched = std::min(firstPatched, b->dataOffset + e.offset);
+    }
+    if (firstPatched != SIZE_MAX) {
+        SwishCrypto::refreshImageHash(blocks_, firstPatched);
+        markUnwritten(blocks_.image.size() - SwishCrypto::SIZE_HASH, SwishCrypto::SIZE_HASH);
+        fileDigestValid_ = false;
+    }
+    invalidateDonutCount();
+    return patched;
+}
+
+bool SaveFile::hasUnsavedChanges() const {
+    if (!unwrittenRanges_.empty())
+        return true;
+    // Called every frame; memcmp of the block is cheaper than hashing it
+    // and stops at the first difference.
+    return donutData_ && std::memcmp(donutData_, savedDonuts_.get(), donutDataLen_) != 0;
+}
+
+// Ranges come in ascending order within a save, so contiguous slots merge
+// into one write.
+void SaveFile::markUnwritten(size_t offset, size_t len) {
+    if (!unwrittenRanges_.empty()) {
+        auto& last = unwrittenRanges_.back();
+        if (last.first + last.second == offset) {
+            last.second += len;
+            return;
+        }
+    }
+    unwrittenRanges_.emplace_back(offset, len);
+}
+
+// Hashes the re-encryption as it streams out, so no copy of the file is
+// built. Untouched blocks come straight from the image; this checks that
+// the donut block as last saved re-encrypts to the image.
+static std::string checkRoundTrip(const SCBlockStore& store, const SCBlock* substitute,
+                                  const uint8_t* fileDigest, size_t fileSize) {
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    size_t streamed = 0;
+    bool ok = SwishCrypto::encryptStream(store, [&](const uint8_t* data, size_t len) {
+        sha256_update(&ctx, data, len);
+        streamed += len;
+        return true;
+    }, substitute);
+    if (!ok)
+        return "Re-encryption failed";
 
-    if (reEncrypted.size() != originalFileData_.size()) {
+    if (streamed != fileSize) {
         char buf[128];
         std::snprintf(buf, sizeof(buf), "Size mismatch: original %zu, re-encrypted %zu",
-                      originalFileData_.size(), reEncrypted.size());
-        originalFileData_.clear();
+                      fileSize, streamed);
         return buf;
     }
 
-    for (size_t i = 0; i < reEncrypted.size(); i++) {
-        if (reEncrypted[i] != originalFileData_[i]) {
-            char buf[128];
-            std::snprintf(buf, sizeof(buf), "Mismatch at byte %zu: original 0x%02X, got 0x%02X",
-                          i, originalFileData_[i], reEncrypted[i]);
-            originalFileData_.clear();
-            return buf;
-        }
+    uint8_t digest[32];
+    sha256_final(&ctx, digest);
+    if (std::memcmp(digest, fileDigest, sizeof(digest)) != 0)
+        return "Hash mismatch: re-encrypted save differs from original";
+    return "OK";
+}
+
+void SaveFile::startVerify() {
+    waitVerify();
+    verifyPending_ = true;
+    verifyDone_ = false;
+    if (!loaded_ || fileSize_ == 0) {
+        verifyResult_ = "No original data to verify";
+        verifyDone_ = true;
+        return;
     }
 
-    originalFileData_.clear();
-    return "OK";
+    // The image holds the donut block as last saved, so unsaved edits are
+    // left out of the check.
+    const SCBlock* substitute = nullptr;
+    if (donutBlock_) {
+        verifySnapshot_.reset(new uint8_t[donutDataLen_]);
+        std::memcpy(verifySnapshot_.get(), savedDonuts_.get(), donutDataLen_);
+        verifyBlock_ = *donutBlock_;
+        verifyBlock_.data = verifySnapshot_.get();
+        verifyBlock_.dirty = true;
+        substitute = &verifyBlock_;
+    }
+
+    verifyThread_ = std::thread([this, substitute] {
+        ensureFileDigest();
+        verifyResult_ = checkRoundTrip(blocks_, substitute, fileDigest_, fileSize_);
+        verifyDone_ = true;
+    });
+}
+
+bool SaveFile::pollVerify(std::string& result) {
+    if (!verifyPending_ || !verifyDone_)
+        return false;
+    waitVerify();
+    verifyPending_ = false;
+    result = verifyResult_;
+    return true;
+}
+
+// The digest is taken on first need and dropped whenever the image is
+// patched, so it always matches the image as last loaded or saved.
+void SaveFile::ensureFileDigest() {
+    if (fileDigestValid_)
+        return;
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, blocks_.image.data(), blocks_.image.size());
+    sha256_final(&ctx, fileDigest_);
+    fileDigestValid_ = true;
+}
+
+void SaveFile::waitVerify() {
+    if (verifyThread_.joinable())
+        verifyThread_.join();
+}
+
+std::string SaveFile::verifyRoundTrip() {
+    startVerify();
+    waitVerify();
+    std::string result;
+    pollVerify(result);
+    return result;
 }
 
 Donut9a SaveFile::getDonut(int index) {
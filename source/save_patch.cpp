@@ -0,0 +1,82 @@
+#include "save_patch.h"
+#include <cstring>
+
+static constexpr uint8_t MAGIC[4] = {'P', 'K', 'B', 'P'};
+static constexpr size_t HEADER_SIZE = 4 + 4 + 4;
+static constexpr size_t ENTRY_HEADER_SIZE = 4 + 4 + 4;
+
+static uint8_t* putU32(uint8_t* p, uint32_t v) {
+    std::memcpy(p, &v, 4);
+    return p + 4;
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+void SavePatch::diff(std::vector<Entry>& entries, uint32_t key,
+                     const uint8_t* base, const uint8_t* cur, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        if (base[i] == cur[i]) {
+            i++;
+            continue;
+        }
+        // Extend the run until ENTRY_HEADER_SIZE equal bytes in a row; a
+        // shorter gap is cheaper to carry than a new entry.
+        size_t start = i;
+        size_t end = i + 1;
+        for (size_t j = end; j < len && j - end < ENTRY_HEADER_SIZE; j++) {
+            if (base[j] != cur[j])
+                end = j + 1;
+        }
+        entries.push_back({key, static_cast<uint32_t>(start),
+                           std::vector<uint8_t>(cur + start, cur + end)});
+        i = end;
+    }
+}
+
+std::vector<uint8_t> SavePatch::serialize(const std::vector<Entry>& entries) {
+    size_t size = HEADER_SIZE;
+    for (const auto& e : entries)
+        size += ENTRY_HEADER_SIZE + e.bytes.size();
+
+    std::vector<uint8_t> out(size);
+    uint8_t* p = out.data();
+    std::memcpy(p, MAGIC, 4);
+    p = putU32(p + 4, VERSION);
+    p = putU32(p, static_cast<uint32_t>(entries.size()));
+    for (const auto& e : entries) {
+        p = putU32(p, e.key);
+        p = putU32(p, e.offset);
+        p = putU32(p, static_cast<uint32_t>(e.bytes.size()));
+        if (!e.bytes.empty())
+            std::memcpy(p, e.bytes.data(), e.bytes.size());
+        p += e.bytes.size();
+    }
+    return out;
+}
+
+bool SavePatch::parse(const uint8_t* data, size_t len, std::vector<Entry>& entries) {
+    entries.clear();
+    if (len < HEADER_SIZE || std::memcmp(data, MAGIC, 4) != 0 || getU32(data + 4) != VERSION)
+        return false;
+
+    uint32_t count = getU32(data + 8);
+    size_t pos = HEADER_SIZE;
+    for (uint32_t n = 0; n < count; n++) {
+        if (len - pos < ENTRY_HEADER_SIZE)
+            return false;
+        uint32_t key = getU32(data + pos);
+        uint32_t offset = getU32(data + pos + 4);
+        uint32_t size = getU32(data + pos + 8);
+        pos += ENTRY_HEADER_SIZE;
+        if (len - pos < size)
+            return false;
+        entries.push_back({key, offset, std::vector<uint8_t>(data + pos, data + pos + size)});
+        pos += size;
+    }
+    return pos == len;
+}
@@ -0,0 +1,22 @@
+#include "sc_arena.h"
+#include <algorithm>
+
+void SCArena::newSlab(size_t size) {
+    slabs_.emplace_back(new uint8_t[size]);
+    cursor_ = slabs_.back().get();
+    left_ = size;
+}
+
+void SCArena::reserve(size_t capacity) {
+    if (capacity > left_)
+        newSlab(capacity);
+}
+
+uint8_t* SCArena::alloc(size_t len) {
+    if (len > left_)
+        newSlab(std::max(len, MIN_SLAB));
+    uint8_t* p = cursor_;
+    cursor_ += len;
+    left_ -= len;
+    return p;
+}
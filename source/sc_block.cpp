@@ -1,5 +1,6 @@
 #include "sc_block.h"
 #include <cstring>
+#include <algorithm>
 
 static inline uint32_t readU32LE(const uint8_t* p) {
     uint32_t v;
@@ -11,54 +12,92 @@ static inline void writeU32LE(uint8_t* p, uint32_t v) {
     std::memcpy(p, &v, 4);
 }
 
-SCBlock SCBlock::readFromOffset(const uint8_t* buf, size_t bufLen, size_t& offset) {
+static constexpr uint32_t applyMatrix(const std::array<uint32_t, 32>& cols, uint32_t v) {
+    uint32_t r = 0;
+    for (int j = 0; j < 32; j++)
+        r ^= cols[j] & (0u - ((v >> j) & 1));
+    return r;
+}
+
+constexpr std::array<SCXorShift32::JumpMatrix, 64> SCXorShift32::buildJumpPowers() {
+    std::array<JumpMatrix, 64> powers{};
+    for (int j = 0; j < 32; j++)
+        powers[0][j] = xorshiftAdvance(1u << j);
+    for (int k = 1; k < 64; k++)
+        for (int j = 0; j < 32; j++)
+            powers[k][j] = applyMatrix(powers[k - 1], powers[k - 1][j]);
+    return powers;
+}
+
+const std::array<SCXorShift32::JumpMatrix, 64> SCXorShift32::JUMP_POWERS =
+    SCXorShift32::buildJumpPowers();
+
+void SCXorShift32::jump(uint64_t n) {
+    // A matrix application costs about as much as 32 plain steps.
+    if (n < 64) {
+        for (; n > 0; n--)
+            state_ = xorshiftAdvance(state_);
+        return;
+    }
+    for (int k = 0; n != 0; k++, n >>= 1) {
+        if (n & 1)
+            state_ = applyMatrix(JUMP_POWERS[k], state_);
+    }
+}
+
+SCBlock SCBlock::readHeader(const uint8_t* hdr, size_t offset) {
     SCBlock block{};
+    block.offset = offset;
+    size_t pos = 0;
 
-    block.key = readU32LE(buf + offset);
-    offset += 4;
+    block.key = readU32LE(hdr + pos);
+    pos += 4;
 
     SCXorShift32 xk(block.key);
 
-    block.type = static_cast<SCTypeCode>(buf[offset++] ^ xk.next());
+    block.type = static_cast<SCTypeCode>(hdr[pos++] ^ xk.next());
 
     switch (block.type) {
         case SCTypeCode::Bool1:
         case SCTypeCode::Bool2:
         case SCTypeCode::Bool3:
-            return block;
+            break;
 
         case SCTypeCode::Object: {
-            int32_t numBytes = static_cast<int32_t>(readU32LE(buf + offset) ^ static_cast<uint32_t>(xk.next32()));
-            offset += 4;
-            block.data.resize(numBytes);
-            for (int32_t i = 0; i < numBytes; i++)
-                block.data[i] = buf[offset + i] ^ xk.next();
-            offset += numBytes;
-            return block;
+            int32_t numBytes = static_cast<int32_t>(readU32LE(hdr + pos) ^ static_cast<uint32_t>(xk.next32()));
+            pos += 4;
+            block.dataLen = static_cast<size_t>(numBytes);
+            break;
         }
 
         case SCTypeCode::Array: {
-            int32_t numEntries = static_cast<int32_t>(readU32LE(buf + offset) ^ static_cast<uint32_t>(xk.next32()));
-            offset += 4;
-            block.subType = static_cast<SCTypeCode>(buf[offset++] ^ xk.next());
+            int32_t numEntries = static_cast<int32_t>(readU32LE(hdr + pos) ^ static_cast<uint32_t>(xk.next32()));
+            pos += 4;
+            block.subType = static_cast<SCTypeCode>(hdr[pos++] ^ xk.next());
             int elemSize = getTypeSize(block.subType);
-            int32_t numBytes = numEntries * elemSize;
-            block.data.resize(numBytes);
-            for (int32_t i = 0; i < numBytes; i++)
-                block.data[i] = buf[offset + i] ^ xk.next();
-            offset += numBytes;
-            return block;
+            block.dataLen = static_cast<size_t>(static_cast<int64_t>(numEntries) * elemSize);
+            break;
         }
 
-        default: {
-            int numBytes = getTypeSize(block.type);
-            block.data.resize(numBytes);
-            for (int i = 0; i < numBytes; i++)
-                block.data[i] = buf[offset + i] ^ xk.next();
-            offset += numBytes;
-            return block;
-        }
+        default:
+            block.dataLen = static_cast<size_t>(getTypeSize(block.type));
+            break;
     }
+
+    block.dataOffset = offset + pos;
+    return block;
+}
+
+void SCBlock::cryptPayload(uint8_t* dst, const uint8_t* src) const {
+    cryptPayloadRange(dst, src, 0, dataLen);
+}
+
+void SCBlock::cryptPayloadRange(uint8_t* dst, const uint8_t* src, size_t pos, size_t len) const {
+    SCXorShift32 xk(key);
+    // The header after the key (type, length, subtype) consumed the first
+    // keystream bytes.
+    xk.skip(dataOffset - offset - 4 + pos);
+    xk.xorInto(dst, src, len);
 }
 
 size_t SCBlock::encodedSize() const {
@@ -69,42 +108,64 @@ size_t SCBlock::encodedSize() const {
         case SCTypeCode::Bool3:
             break;
         case SCTypeCode::Object:
-            size += 4 + data.size();
+            size += 4 + dataLen;
             break;
         case SCTypeCode::Array:
-            size += 4 + 1 + data.size();
+            size += 4 + 1 + dataLen;
             break;
         default:
-            size += data.size();
+            size += dataLen;
             break;
     }
     return size;
 }
 
-size_t SCBlock::writeBlock(uint8_t* out) const {
+size_t SCBlock::writeHeader(uint8_t* out, SCXorShift32& xk) const {
     size_t pos = 0;
 
     writeU32LE(out + pos, key);
     pos += 4;
 
-    SCXorShift32 xk(key);
-
     out[pos++] = static_cast<uint8_t>(type) ^ xk.next();
 
     if (type == SCTypeCode::Object) {
-        uint32_t len = static_cast<uint32_t>(data.size());
+        uint32_t len = static_cast<uint32_t>(dataLen);
         writeU32LE(out + pos, len ^ static_cast<uint32_t>(xk.next32()));
         pos += 4;
     } else if (type == SCTypeCode::Array) {
         int elemSize = getTypeSize(subType);
-        uint32_t entries = elemSize > 0 ? static_cast<uint32_t>(data.size() / elemSize) : 0;
+        uint32_t entries = elemSize > 0 ? static_cast<uint32_t>(dataLen / elemSize) : 0;
         writeU32LE(out + pos, entries ^ static_cast<uint32_t>(xk.next32()));
         pos += 4;
         out[pos++] = static_cast<uint8_t>(subType) ^ xk.next();
     }
 
-    for (size_t i = 0; i < data.size(); i++)
-        out[pos++] = data[i] ^ xk.next();
+    return pos;
+}
+
+size_t SCBlock::writeBlock(uint8_t* out) const {
+    SCXorShift32 xk(key);
+    size_t pos = writeHeader(out, xk);
+
+    xk.xorInto(out + pos, data, dataLen);
+    pos += dataLen;
 
     return pos;
 }
+
+SCBlockWriter::SCBlockWriter(const SCBlock& block)
+    : block_(&block), xk_(block.key) {
+    headerLen_ = block.writeHeader(header_, xk_);
+}
+
+void SCBlockWriter::write(uint8_t* out, size_t len) {
+    if (pos_ < headerLen_) {
+        size_t n = std::min(len, headerLen_ - pos_);
+        std::memcpy(out, header_ + pos_, n);
+        out += n;
+        len -= n;
+        pos_ += n;
+    }
+    xk_.xorInto(out, block_->data + (pos_ - headerLen_), len);
+    pos_ += len;
+}
@@ -0,0 +1,63 @@
+#include "sc_image.h"
+#include <utility>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SCImage::~SCImage() {
+    unmap();
+}
+
+SCImage::SCImage(SCImage&& other) noexcept
+    : owned_(std::move(other.owned_)), map_(other.map_), mapLen_(other.mapLen_) {
+    other.map_ = nullptr;
+    other.mapLen_ = 0;
+}
+
+SCImage& SCImage::operator=(SCImage&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        owned_ = std::move(other.owned_);
+        map_ = other.map_;
+        mapLen_ = other.mapLen_;
+        other.map_ = nullptr;
+        other.mapLen_ = 0;
+    }
+    return *this;
+}
+
+void SCImage::unmap() {
+#if defined(__linux__)
+    if (map_)
+        munmap(map_, mapLen_);
+#endif
+    map_ = nullptr;
+    mapLen_ = 0;
+}
+
+bool SCImage::mapFile(const std::string& path) {
+    unmap();
+    owned_.clear();
+#if defined(__linux__)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+    map_ = static_cast<uint8_t*>(p);
+    mapLen_ = static_cast<size_t>(st.st_size);
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
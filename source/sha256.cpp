@@ -0,0 +1,269 @@
+#include "sha256.h"
+#include <cstring>
+#include <algorithm>
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define SHA256_HAVE_ARMV8 1
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SHA256_HAVE_SHANI 1
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+
+static const uint32_t K256[64] = {
+    0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
+    0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
+    0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
+    0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
+    0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
+    0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
+    0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
+    0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2,
+};
+
+// --- Scalar backend ---
+
+static inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+static inline uint32_t ch(uint32_t x, uint32_t y, uint32_t z) { return (x & y) ^ (~x & z); }
+static inline uint32_t maj(uint32_t x, uint32_t y, uint32_t z) { return (x & y) ^ (x & z) ^ (y & z); }
+static inline uint32_t sig0(uint32_t x) { return rotr(x,2) ^ rotr(x,13) ^ rotr(x,22); }
+static inline uint32_t sig1(uint32_t x) { return rotr(x,6) ^ rotr(x,11) ^ rotr(x,25); }
+static inline uint32_t gam0(uint32_t x) { return rotr(x,7) ^ rotr(x,18) ^ (x >> 3); }
+static inline uint32_t gam1(uint32_t x) { return rotr(x,17) ^ rotr(x,19) ^ (x >> 10); }
+
+static void transformScalar(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    for (; blocks > 0; blocks--, data += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++)
+            w[i] = (uint32_t(data[i*4]) << 24) | (uint32_t(data[i*4+1]) << 16) |
+                   (uint32_t(data[i*4+2]) << 8) | uint32_t(data[i*4+3]);
+        for (int i = 16; i < 64; i++)
+            w[i] = gam1(w[i-2]) + w[i-7] + gam0(w[i-15]) + w[i-16];
+
+        uint32_t a=state[0], b=state[1], c=state[2], d=state[3];
+        uint32_t e=state[4], f=state[5], g=state[6], h=state[7];
+
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + sig1(e) + ch(e,f,g) + K256[i] + w[i];
+            uint32_t t2 = sig0(a) + maj(a,b,c);
+            h=g; g=f; f=e; e=d+t1; d=c; c=b; b=a; a=t1+t2;
+        }
+
+        state[0]+=a; state[1]+=b; state[2]+=c; state[3]+=d;
+        state[4]+=e; state[5]+=f; state[6]+=g; state[7]+=h;
+    }
+}
+
+static bool supportedScalar() { return true; }
+
+// --- ARMv8 Crypto Extensions backend ---
+
+#ifdef SHA256_HAVE_ARMV8
+// Each step runs four rounds; msg[i % 4] holds W[4i .. 4i+3] and is
+// replaced by W[4i+16 .. 4i+19] once consumed.
+static void transformArmv8(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    uint32x4_t abcd = vld1q_u32(&state[0]);
+    uint32x4_t efgh = vld1q_u32(&state[4]);
+
+    for (; blocks > 0; blocks--, data += 64) {
+        uint32x4_t abcdSave = abcd;
+        uint32x4_t efghSave = efgh;
+        uint32x4_t msg[4];
+        for (int i = 0; i < 4; i++)
+            msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+
+        for (int i = 0; i < 16; i++) {
+            uint32x4_t wk = vaddq_u32(msg[i % 4], vld1q_u32(&K256[i * 4]));
+            uint32x4_t abcdPrev = abcd;
+            abcd = vsha256hq_u32(abcd, efgh, wk);
+            efgh = vsha256h2q_u32(efgh, abcdPrev, wk);
+            if (i < 12) {
+                msg[i % 4] = vsha256su1q_u32(vsha256su0q_u32(msg[i % 4], msg[(i + 1) % 4]),
+                                             msg[(i + 2) % 4], msg[(i + 3) % 4]);
+            }
+        }
+
+        abcd = vaddq_u32(abcd, abcdSave);
+        efgh = vaddq_u32(efgh, efghSave);
+    }
+
+    vst1q_u32(&state[0], abcd);
+    vst1q_u32(&state[4], efgh);
+}
+
+static bool supportedArmv8() {
+#if defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+#else
+    // Built with the crypto extension enabled (the Switch's Cortex-A57
+    // always has it).
+    return true;
+#endif
+}
+#endif
+
+// --- x86 SHA-NI backend ---
+
+#ifdef SHA256_HAVE_SHANI
+// sha256rnds2 works on the state split as ABEF/CDGH, so the state words
+// are shuffled in and out of that layout around the block loop.
+__attribute__((target("sha,sse4.1,ssse3")))
+static void transformShaNi(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+    __m128i cdgh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+    tmp  = _mm_shuffle_epi32(tmp, 0xB1);          // CDAB
+    cdgh = _mm_shuffle_epi32(cdgh, 0x1B);         // EFGH
+    __m128i abef = _mm_alignr_epi8(tmp, cdgh, 8); // ABEF
+    cdgh = _mm_blend_epi16(cdgh, tmp, 0xF0);      // CDGH
+
+    for (; blocks > 0; blocks--, data += 64) {
+        __m128i abefSave = abef;
+        __m128i cdghSave = cdgh;
+        __m128i msg[4];
+        for (int i = 0; i < 4; i++)
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)), byteSwap);
+
+        for (int i = 0; i < 16; i++) {
+            __m128i wk = _mm_add_epi32(msg[i % 4], _mm_loadu_si128(reinterpret_cast<const __m128i*>(&K256[i * 4])));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0E));
+            if (i < 12) {
+                __m128i w = _mm_sha256msg1_epu32(msg[i % 4], msg[(i + 1) % 4]);
+                w = _mm_add_epi32(w, _mm_alignr_epi8(msg[(i + 3) % 4], msg[(i + 2) % 4], 4));
+                msg[i % 4] = _mm_sha256msg2_epu32(w, msg[(i + 3) % 4]);
+            }
+        }
+
+        abef = _mm_add_epi32(abef, abefSave);
+        cdgh = _mm_add_epi32(cdgh, cdghSave);
+    }
+
+    tmp  = _mm_shuffle_epi32(abef, 0x1B);         // FEBA
+    cdgh = _mm_shuffle_epi32(cdgh, 0xB1);         // DCHG
+    abef = _mm_blend_epi16(tmp, cdgh, 0xF0);      // DCBA
+    cdgh = _mm_alignr_epi8(cdgh, tmp, 8);         // EFGH
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), abef);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), cdgh);
+}
+
+static bool supportedShaNi() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+    bool ssse3 = (ecx & bit_SSSE3) != 0;
+    bool sse41 = (ecx & bit_SSE4_1) != 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        return false;
+    bool sha = (ebx & bit_SHA) != 0;
+    return ssse3 && sse41 && sha;
+}
+#endif
+
+// --- Backend selection ---
+
+static const SHA256Backend BACKENDS[] = {
+#ifdef SHA256_HAVE_ARMV8
+    {"armv8-ce", transformArmv8, supportedArmv8},
+#endif
+#ifdef SHA256_HAVE_SHANI
+    {"sha-ni", transformShaNi, supportedShaNi},
+#endif
+    {"scalar", transformScalar, supportedScalar},
+};
+
+static constexpr int BACKEND_COUNT = sizeof(BACKENDS) / sizeof(BACKENDS[0]);
+
+static const SHA256Backend* detectBackend() {
+#if defined(SHA256_HAVE_ARMV8) && defined(__SWITCH__)
+    // The ARMv8 backend has not been run on the console yet; until it passes
+    // test_crypto's known-answer tests on aarch64 it is only used when
+    // picked with sha256SetBackend().
+    return &BACKENDS[BACKEND_COUNT - 1];
+#endif
+    for (int i = 0; i < BACKEND_COUNT; i++) {
+        if (BACKENDS[i].supported())
+            return &BACKENDS[i];
+    }
+    return &BACKENDS[BACKEND_COUNT - 1];
+}
+
+// Resolved during static initialization, before main() runs.
+static const SHA256Backend* s_backend = detectBackend();
+
+const SHA256Backend* sha256Backends(int& count) {
+    count = BACKEND_COUNT;
+    return BACKENDS;
+}
+
+const SHA256Backend& sha256ActiveBackend() {
+    return *s_backend;
+}
+
+void sha256SetBackend(const SHA256Backend& backend) {
+    s_backend = &backend;
+}
+
+// --- Streaming interface ---
+
+void sha256_init(SHA256_CTX* ctx) {
+    ctx->state[0]=0x6a09e667; ctx->state[1]=0xbb67ae85;
+    ctx->state[2]=0x3c6ef372; ctx->state[3]=0xa54ff53a;
+    ctx->state[4]=0x510e527f; ctx->state[5]=0x9b05688c;
+    ctx->state[6]=0x1f83d9ab; ctx->state[7]=0x5be0cd19;
+    ctx->bitcount = 0;
+    std::memset(ctx->buffer, 0, 64);
+}
+
+void sha256_update(SHA256_CTX* ctx, const uint8_t* data, size_t len) {
+    SHA256TransformFn transform = s_backend->transform;
+    size_t bufIdx = static_cast<size_t>((ctx->bitcount >> 3) & 63);
+    ctx->bitcount += static_cast<uint64_t>(len) << 3;
+    size_t i = 0;
+    if (bufIdx > 0) {
+        size_t space = 64 - bufIdx;
+        size_t toCopy = std::min(len, space);
+        std::memcpy(ctx->buffer + bufIdx, data, toCopy);
+        i = toCopy;
+        if (bufIdx + toCopy == 64) {
+            transform(ctx->state, ctx->buffer, 1);
+        }
+    }
+    size_t blocks = (len - i) / 64;
+    if (blocks > 0) {
+        transform(ctx->state, data + i, blocks);
+        i += blocks * 64;
+    }
+    if (i < len)
+        std::memcpy(ctx->buffer, data + i, len - i);
+}
+
+void sha256_final(SHA256_CTX* ctx, uint8_t hash[32]) {
+    SHA256TransformFn transform = s_backend->transform;
+    size_t bufIdx = static_cast<size_t>((ctx->bitcount >> 3) & 63);
+    ctx->buffer[bufIdx++] = 0x80;
+    if (bufIdx > 56) {
+        std::memset(ctx->buffer + bufIdx, 0, 64 - bufIdx);
+        transform(ctx->state, ctx->buffer, 1);
+        bufIdx = 0;
+    }
+    std::memset(ctx->buffer + bufIdx, 0, 56 - bufIdx);
+    uint64_t bits = ctx->bitcount;
+    for (int i = 7; i >= 0; i--)
+        ctx->buffer[56 + (7 - i)] = static_cast<uint8_t>(bits >> (i * 8));
+    transform(ctx->state, ctx->buffer, 1);
+    for (int i = 0; i < 8; i++) {
+        hash[i*4+0] = static_cast<uint8_t>(ctx->state[i] >> 24);
+        hash[i*4+1] = static_cast<uint8_t>(ctx->state[i] >> 16);
+        hash[i*4+2] = static_cast<uint8_t>(ctx->state[i] >> 8);
+        hash[i*4+3] = static_cast<uint8_t>(ctx->state[i]);
+    }
+}
@@ -1,8 +1,18 @@
 #include "swish_crypto.h"
+#include "sha256.h"
 #include <cstring>
 #include <algorithm>
+#include <array>
+#include <optional>
+#include <utility>
 
-static const uint8_t STATIC_XORPAD[128] = {
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static constexpr uint8_t STATIC_XORPAD[128] = {
     0xA0, 0x92, 0xD1, 0x06, 0x07, 0xDB, 0x32, 0xA1, 0xAE, 0x01, 0xF5, 0xC5, 0x1E, 0x84, 0x4F, 0xE3,
     0x53, 0xCA, 0x37, 0xF4, 0xA7, 0xB0, 0x4D, 0xA0, 0x18, 0xB7, 0xC2, 0x97, 0xDA, 0x5F, 0x53, 0x2B,
     0x75, 0xFA, 0x48, 0x16, 0xF8, 0xD4, 0x8A, 0x6F, 0x61, 0x05, 0xF4, 0xE2, 0xFD, 0x04, 0xB5, 0xA3,
@@ -15,6 +25,28 @@ static const uint8_t STATIC_XORPAD[128] = {
 
 static constexpr size_t XORPAD_SIZE = 0x7F;
 
+// The pad repeats every 127 bytes, which never lines up with a vector
+// register. Expanding it to lcm(127, 32) bytes gives a period that every
+// vector width below divides, so the kernel can XOR whole registers
+// against the expanded pad and restart it at each period boundary. A range
+// starting mid-period reads the expanded pad from its phase, in steps one
+// period shorter so the phase is unchanged from step to step.
+static constexpr size_t XORPAD_EXPANDED_SIZE = XORPAD_SIZE * 32;
+static constexpr size_t XORPAD_PHASED_STEP = XORPAD_EXPANDED_SIZE - XORPAD_SIZE;
+
+struct ExpandedXorpad {
+    alignas(32) std::array<uint8_t, XORPAD_EXPANDED_SIZE> bytes;
+};
+
+static constexpr ExpandedXorpad makeExpandedXorpad() {
+    ExpandedXorpad pad{};
+    for (size_t i = 0; i < XORPAD_EXPANDED_SIZE; i++)
+        pad.bytes[i] = STATIC_XORPAD[i % XORPAD_SIZE];
+    return pad;
+}
+
+static constexpr ExpandedXorpad EXPANDED_XORPAD = makeExpandedXorpad();
+
 static const uint8_t INTRO_HASH[64] = {
     0x9E, 0xC9, 0x9C, 0xD7, 0x0E, 0xD3, 0x3C, 0x44, 0xFB, 0x93, 0x03, 0xDC, 0xEB, 0x39, 0xB4, 0x2A,
     0x19, 0x47, 0xE9, 0x63, 0x4B, 0xA2, 0x33, 0x44, 0x16, 0xBF, 0x82, 0xA2, 0xBA, 0x63, 0x55, 0xB6,
@@ -29,174 +61,321 @@ static const uint8_t OUTRO_HASH[64] = {
     0xF1, 0x26, 0xE0, 0x03, 0x0A, 0xE6, 0x6F, 0xF6, 0x41, 0xBF, 0x7E, 0x59, 0xC2, 0xAE, 0x55, 0xFD,
 };
 
-static constexpr size_t SIZE_HASH = 32;
+using SwishCrypto::SIZE_HASH;
 
-namespace {
+// Hash the image once at load, saving the chaining state every
+// HASH_CHECKPOINT_INTERVAL payload bytes. The intro is exactly one SHA-256
+// block and the interval is a multiple of 64, so each checkpoint falls on a
+// block boundary and the state words alone describe it.
+static void recordHashCheckpoints(SCBlockStore& store, size_t payloadLen) {
+    constexpr size_t INTERVAL = SCBlockStore::HASH_CHECKPOINT_INTERVAL;
+    static_assert(INTERVAL % 64 == 0);
 
-struct SHA256_CTX {
-    uint32_t state[8];
-    uint64_t bitcount;
-    uint8_t  buffer[64];
-};
-
-static const uint32_t K256[64] = {
-    0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
-    0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
-    0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
-    0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
-    0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
-    0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
-    0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
-    0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2,
-};
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, INTRO_HASH, 64);
 
-static inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
-static inline uint32_t ch(uint32_t x, uint32_t y, uint32_t z) { return (x & y) ^ (~x & z); }
-static inline uint32_t maj(uint32_t x, uint32_t y, uint32_t z) { return (x & y) ^ (x & z) ^ (y & z); }
-static inline uint32_t sig0(uint32_t x) { return rotr(x,2) ^ rotr(x,13) ^ rotr(x,22); }
-static inline uint32_t sig1(uint32_t x) { return rotr(x,6) ^ rotr(x,11) ^ rotr(x,25); }
-static inline uint32_t gam0(uint32_t x) { return rotr(x,7) ^ rotr(x,18) ^ (x >> 3); }
-static inline uint32_t gam1(uint32_t x) { return rotr(x,17) ^ rotr(x,19) ^ (x >> 10); }
-
-static void sha256_transform(SHA256_CTX* ctx, const uint8_t* data) {
-    uint32_t w[64];
-    for (int i = 0; i < 16; i++)
-        w[i] = (uint32_t(data[i*4]) << 24) | (uint32_t(data[i*4+1]) << 16) |
-               (uint32_t(data[i*4+2]) << 8) | uint32_t(data[i*4+3]);
-    for (int i = 16; i < 64; i++)
-        w[i] = gam1(w[i-2]) + w[i-7] + gam0(w[i-15]) + w[i-16];
-
-    uint32_t a=ctx->state[0], b=ctx->state[1], c=ctx->state[2], d=ctx->state[3];
-    uint32_t e=ctx->state[4], f=ctx->state[5], g=ctx->state[6], h=ctx->state[7];
-
-    for (int i = 0; i < 64; i++) {
-        uint32_t t1 = h + sig1(e) + ch(e,f,g) + K256[i] + w[i];
-        uint32_t t2 = sig0(a) + maj(a,b,c);
-        h=g; g=f; f=e; e=d+t1; d=c; c=b; b=a; a=t1+t2;
+    store.hashCheckpoints.clear();
+    store.hashCheckpoints.reserve(payloadLen / INTERVAL + 1);
+    for (size_t pos = 0; ; pos += INTERVAL) {
+        SCHashCheckpoint cp;
+        std::memcpy(cp.state, ctx.state, sizeof(cp.state));
+        store.hashCheckpoints.push_back(cp);
+        if (pos + INTERVAL > payloadLen)
+            break;
+        sha256_update(&ctx, store.image.data() + pos, INTERVAL);
     }
-
-    ctx->state[0]+=a; ctx->state[1]+=b; ctx->state[2]+=c; ctx->state[3]+=d;
-    ctx->state[4]+=e; ctx->state[5]+=f; ctx->state[6]+=g; ctx->state[7]+=h;
 }
 
-static void sha256_init(SHA256_CTX* ctx) {
-    ctx->state[0]=0x6a09e667; ctx->state[1]=0xbb67ae85;
-    ctx->state[2]=0x3c6ef372; ctx->state[3]=0xa54ff53a;
-    ctx->state[4]=0x510e527f; ctx->state[5]=0x9b05688c;
-    ctx->state[6]=0x1f83d9ab; ctx->state[7]=0x5be0cd19;
-    ctx->bitcount = 0;
-    std::memset(ctx->buffer, 0, 64);
+// Start the trailer hash at the last checkpoint at or before resumeFrom.
+// Returns the payload offset hashing continues from; the payload bytes
+// before it must match the image the checkpoints were recorded from.
+static size_t beginHash(const SCBlockStore& store, size_t resumeFrom, SHA256_CTX* ctx) {
+    constexpr size_t INTERVAL = SCBlockStore::HASH_CHECKPOINT_INTERVAL;
+    sha256_init(ctx);
+    if (store.hashCheckpoints.empty()) {
+        sha256_update(ctx, INTRO_HASH, 64);
+        return 0;
+    }
+    size_t cpIdx = std::min(resumeFrom / INTERVAL, store.hashCheckpoints.size() - 1);
+    size_t pos = cpIdx * INTERVAL;
+    std::memcpy(ctx->state, store.hashCheckpoints[cpIdx].state, sizeof(ctx->state));
+    ctx->bitcount = static_cast<uint64_t>(64 + pos) << 3;
+    return pos;
 }
 
-static void sha256_update(SHA256_CTX* ctx, const uint8_t* data, size_t len) {
-    size_t bufIdx = static_cast<size_t>((ctx->bitcount >> 3) & 63);
-    ctx->bitcount += static_cast<uint64_t>(len) << 3;
+// XOR len bytes (len <= XORPAD_EXPANDED_SIZE) against the expanded pad,
+// using the widest vector unit the target was built for.
+static void xorpadKernel(uint8_t* data, const uint8_t* pad, size_t len) {
     size_t i = 0;
-    if (bufIdx > 0) {
-        size_t space = 64 - bufIdx;
-        size_t toCopy = std::min(len, space);
-        std::memcpy(ctx->buffer + bufIdx, data, toCopy);
-        i = toCopy;
-        if (bufIdx + toCopy == 64) {
-            sha256_transform(ctx, ctx->buffer);
-        }
+#if defined(__AVX2__)
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pad + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_xor_si256(v, p));
     }
-    for (; i + 64 <= len; i += 64)
-        sha256_transform(ctx, data + i);
-    if (i < len)
-        std::memcpy(ctx->buffer, data + i, len - i);
-}
-
-static void sha256_final(SHA256_CTX* ctx, uint8_t hash[32]) {
-    size_t bufIdx = static_cast<size_t>((ctx->bitcount >> 3) & 63);
-    ctx->buffer[bufIdx++] = 0x80;
-    if (bufIdx > 56) {
-        std::memset(ctx->buffer + bufIdx, 0, 64 - bufIdx);
-        sha256_transform(ctx, ctx->buffer);
-        bufIdx = 0;
+#elif defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pad + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(v, p));
     }
-    std::memset(ctx->buffer + bufIdx, 0, 56 - bufIdx);
-    uint64_t bits = ctx->bitcount;
-    for (int i = 7; i >= 0; i--)
-        ctx->buffer[56 + (7 - i)] = static_cast<uint8_t>(bits >> (i * 8));
-    sha256_transform(ctx, ctx->buffer);
-    for (int i = 0; i < 8; i++) {
-        hash[i*4+0] = static_cast<uint8_t>(ctx->state[i] >> 24);
-        hash[i*4+1] = static_cast<uint8_t>(ctx->state[i] >> 16);
-        hash[i*4+2] = static_cast<uint8_t>(ctx->state[i] >> 8);
-        hash[i*4+3] = static_cast<uint8_t>(ctx->state[i]);
+#elif defined(__ARM_NEON)
+    for (; i + 64 <= len; i += 64) {
+        uint8x16x4_t v = vld1q_u8_x4(data + i);
+        uint8x16x4_t p = vld1q_u8_x4(pad + i);
+        v.val[0] = veorq_u8(v.val[0], p.val[0]);
+        v.val[1] = veorq_u8(v.val[1], p.val[1]);
+        v.val[2] = veorq_u8(v.val[2], p.val[2]);
+        v.val[3] = veorq_u8(v.val[3], p.val[3]);
+        vst1q_u8_x4(data + i, v);
     }
+    for (; i + 16 <= len; i += 16)
+        vst1q_u8(data + i, veorq_u8(vld1q_u8(data + i), vld1q_u8(pad + i)));
+#endif
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v, p;
+        std::memcpy(&v, data + i, 8);
+        std::memcpy(&p, pad + i, 8);
+        v ^= p;
+        std::memcpy(data + i, &v, 8);
+    }
+    for (; i < len; i++)
+        data[i] ^= pad[i];
 }
 
-} // anonymous namespace
+void SwishCrypto::cryptStaticXorpadBytes(uint8_t* data, size_t len, size_t fileOffset) {
+    size_t phase = fileOffset % XORPAD_SIZE;
+    const uint8_t* pad = EXPANDED_XORPAD.bytes.data() + phase;
+    size_t step = phase == 0 ? XORPAD_EXPANDED_SIZE : XORPAD_PHASED_STEP;
+    size_t i = 0;
+    for (; i + step <= len; i += step)
+        xorpadKernel(data + i, pad, step);
+    xorpadKernel(data + i, pad, len - i);
+}
 
-static void computeHash(const uint8_t* payload, size_t payloadLen, uint8_t out[32]) {
-    SHA256_CTX ctx;
-    sha256_init(&ctx);
-    sha256_update(&ctx, INTRO_HASH, 64);
-    sha256_update(&ctx, payload, payloadLen);
-    sha256_update(&ctx, OUTRO_HASH, 64);
-    sha256_final(&ctx, out);
+// Sort (key, block) pairs so findBlock can binary search. Ties keep block
+// order, so duplicate keys resolve to the first block like a linear scan.
+static void buildKeyIndex(SCBlockStore& store) {
+    store.keyIndex.resize(store.blocks.size());
+    for (size_t i = 0; i < store.blocks.size(); i++)
+        store.keyIndex[i] = {store.blocks[i].key, static_cast<uint32_t>(i)};
+    std::sort(store.keyIndex.begin(), store.keyIndex.end(),
+              [](const SCBlockKeyIndex& a, const SCBlockKeyIndex& b) {
+                  return a.key != b.key ? a.key < b.key : a.block < b.block;
+              });
 }
 
-void SwishCrypto::cryptStaticXorpadBytes(uint8_t* data, size_t len) {
-    size_t i = 0;
-    while (i + XORPAD_SIZE <= len) {
-        for (size_t j = 0; j < XORPAD_SIZE; j++)
-            data[i + j] ^= STATIC_XORPAD[j];
-        i += XORPAD_SIZE;
+static const SCBlockKeyIndex* lookupKey(const SCBlockStore& store, uint32_t key) {
+    auto it = std::lower_bound(store.keyIndex.begin(), store.keyIndex.end(), key,
+                               [](const SCBlockKeyIndex& e, uint32_t k) { return e.key < k; });
+    if (it == store.keyIndex.end() || it->key != key)
+        return nullptr;
+    return &*it;
+}
+
+// Copy a block's payload out of the image, strip the static pad and the
+// block keystream.
+static void decryptBlockInto(const SCBlockStore& store, SCBlock& b, uint8_t* out) {
+    std::memcpy(out, store.image.data() + b.dataOffset, b.dataLen);
+    SwishCrypto::cryptStaticXorpadBytes(out, b.dataLen, b.dataOffset);
+    b.cryptPayload(out, out);
+    b.data = out;
+}
+
+uint8_t* SCBlockStore::data(SCBlock& b) {
+    if (!b.data) {
+        decryptBlockInto(*this, b, arena.alloc(b.dataLen));
     }
-    for (size_t j = 0; i + j < len; j++)
-        data[i + j] ^= STATIC_XORPAD[j];
+    return b.data;
 }
 
-std::vector<SCBlock> SwishCrypto::decrypt(uint8_t* fileData, size_t fileSize) {
-    size_t payloadLen = fileSize - SIZE_HASH;
-    cryptStaticXorpadBytes(fileData, payloadLen);
+SCBlockStore SwishCrypto::decrypt(std::vector<uint8_t> fileData, DecryptMode mode) {
+    return decrypt(SCImage(std::move(fileData)), mode);
+}
+
+SCBlockStore SwishCrypto::decrypt(SCImage image, DecryptMode mode) {
+    SCBlockStore store;
+    if (image.size() < SIZE_HASH)
+        return store;
 
-    std::vector<SCBlock> blocks;
-    blocks.reserve(payloadLen / 500);
+    size_t payloadLen = image.size() - SIZE_HASH;
+    store.image = std::move(image);
+    bool recordCheckpoints = !store.image.isMapped();
+
+    // Header walk: only the few header bytes of each block are un-padded.
+    store.blocks.reserve(payloadLen / 500);
     size_t offset = 0;
+    size_t totalDataLen = 0;
     while (offset < payloadLen) {
-        blocks.push_back(SCBlock::readFromOffset(fileData, payloadLen, offset));
+        uint8_t hdr[SCBlock::MAX_HEADER_SIZE] = {};
+        size_t hdrLen = std::min(SCBlock::MAX_HEADER_SIZE, payloadLen - offset);
+        std::memcpy(hdr, store.image.data() + offset, hdrLen);
+        cryptStaticXorpadBytes(hdr, hdrLen, offset);
+        const SCBlock& b = store.blocks.emplace_back(SCBlock::readHeader(hdr, offset));
+        // A negative length comes out huge; either way a payload running
+        // past the end means a corrupt file, so nothing of it is kept.
+        if (b.dataOffset > payloadLen || b.dataLen > payloadLen - b.dataOffset)
+            return SCBlockStore();
+        offset = b.dataOffset + b.dataLen;
+        totalDataLen += b.dataLen;
     }
+    buildKeyIndex(store);
 
-    return blocks;
+    if (recordCheckpoints)
+        recordHashCheckpoints(store, payloadLen);
+    if (mode == DecryptMode::Full) {
+        // One slab holds every payload back to back.
+        store.arena.reserve(totalDataLen);
+        uint8_t* out = store.arena.alloc(totalDataLen);
+        for (auto& b : store.blocks) {
+            decryptBlockInto(store, b, out);
+            out += b.dataLen;
+        }
+    }
+
+    return store;
 }
 
-std::vector<uint8_t> SwishCrypto::encrypt(const std::vector<SCBlock>& blocks) {
-    size_t totalSize = 0;
-    for (auto& b : blocks)
-        totalSize += b.encodedSize();
-    totalSize += SIZE_HASH;
+// Output is produced in chunks small enough to stay in L1 (the A57 has
+// 32 KB): each chunk is copied from the image, overlaid with the dirty
+// blocks that cross it, padded and hashed before moving on. Must divide
+// HASH_CHECKPOINT_INTERVAL so resumed hashing starts on a chunk boundary.
+static constexpr size_t ENCRYPT_CHUNK = 0x4000;
+static_assert(SCBlockStore::HASH_CHECKPOINT_INTERVAL % ENCRYPT_CHUNK == 0);
+
+// Produces the encrypted file one chunk at a time. chunkBuffer(offset)
+// returns where the chunk at that payload offset is built; emit(offset,
+// data, len) receives each finished chunk and finally the hash trailer.
+// substitute, if set, is encoded in place of the block with its key.
+template <typename ChunkBuffer, typename Emit>
+static bool encodeChunks(const SCBlockStore& store, const SCBlock* substitute,
+                         ChunkBuffer chunkBuffer, Emit emit) {
+    size_t payloadLen = store.payloadSize();
+    if (store.image.size() != payloadLen + SIZE_HASH)
+        return false;
 
-    std::vector<uint8_t> result(totalSize, 0);
+    auto blockAt = [&](size_t i) -> const SCBlock& {
+        const SCBlock& b = store.blocks[i];
+        return substitute && b.key == substitute->key ? *substitute : b;
+    };
 
-    size_t pos = 0;
-    for (auto& b : blocks)
-        pos += b.writeBlock(result.data() + pos);
+    // Clean blocks keep their original ciphertext from the image; only
+    // dirty blocks are serialized and padded again. Hashing resumes at the
+    // last checkpoint before the first dirty block.
+    auto needsEncoding = [&](size_t i) { return blockAt(i).dirty; };
+    size_t nextDirty = 0;
+    while (nextDirty < store.blocks.size() && !needsEncoding(nextDirty))
+        nextDirty++;
+    size_t firstDirty = nextDirty < store.blocks.size() ? store.blocks[nextDirty].offset : payloadLen;
 
-    size_t payloadLen = pos;
+    SHA256_CTX ctx;
+    size_t hashFrom = beginHash(store, firstDirty, &ctx);
+
+    std::optional<SCBlockWriter> writer;
+    for (size_t chunk = 0; chunk < payloadLen; chunk += ENCRYPT_CHUNK) {
+        size_t chunkEnd = std::min(chunk + ENCRYPT_CHUNK, payloadLen);
+        uint8_t* out = chunkBuffer(chunk);
+        std::memcpy(out, store.image.data() + chunk, chunkEnd - chunk);
 
-    cryptStaticXorpadBytes(result.data(), payloadLen);
-    computeHash(result.data(), payloadLen, result.data() + payloadLen);
+        while (nextDirty < store.blocks.size()) {
+            const SCBlock& b = blockAt(nextDirty);
+            if (b.offset >= chunkEnd)
+                break;
+            if (!writer)
+                writer.emplace(b);
+            size_t blockEnd = b.offset + b.encodedSize();
+            size_t from = std::max(b.offset, chunk);
+            size_t to = std::min(blockEnd, chunkEnd);
+            writer->write(out + (from - chunk), to - from);
+            SwishCrypto::cryptStaticXorpadBytes(out + (from - chunk), to - from, from);
+            if (blockEnd > chunkEnd)
+                break;
+            writer.reset();
+            do {
+                nextDirty++;
+            } while (nextDirty < store.blocks.size() && !needsEncoding(nextDirty));
+        }
 
-    result.resize(payloadLen + SIZE_HASH);
+        if (chunkEnd > hashFrom) {
+            size_t from = std::max(chunk, hashFrom);
+            sha256_update(&ctx, out + (from - chunk), chunkEnd - from);
+        }
+        if (!emit(chunk, out, chunkEnd - chunk))
+            return false;
+    }
+
+    uint8_t trailer[SIZE_HASH];
+    sha256_update(&ctx, OUTRO_HASH, 64);
+    sha256_final(&ctx, trailer);
+    return emit(payloadLen, trailer, SIZE_HASH);
+}
+
+std::vector<uint8_t> SwishCrypto::encrypt(const SCBlockStore& store) {
+    size_t payloadLen = store.payloadSize();
+    std::vector<uint8_t> result(payloadLen + SIZE_HASH);
+    bool ok = encodeChunks(store, nullptr,
+        [&](size_t offset) { return result.data() + offset; },
+        [&](size_t offset, const uint8_t* data, size_t len) {
+            if (offset == payloadLen)
+                std::memcpy(result.data() + offset, data, len);
+            return true;
+        });
+    if (!ok)
+        return {};
     return result;
 }
 
-SCBlock* SwishCrypto::findBlock(std::vector<SCBlock>& blocks, uint32_t key) {
-    for (auto& b : blocks) {
-        if (b.key == key)
-            return &b;
-    }
-    return nullptr;
+bool SwishCrypto::encryptStream(const SCBlockStore& store, const ChunkSink& sink,
+                                const SCBlock* substitute) {
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[ENCRYPT_CHUNK]);
+    return encodeChunks(store, substitute,
+        [&](size_t) { return buf.get(); },
+        [&](size_t, const uint8_t* data, size_t len) { return sink(data, len); });
 }
 
-const SCBlock* SwishCrypto::findBlock(const std::vector<SCBlock>& blocks, uint32_t key) {
-    for (auto& b : blocks) {
-        if (b.key == key)
-            return &b;
+bool SwishCrypto::patchImage(SCBlockStore& store, const SCBlock& b, size_t pos, size_t len) {
+    if (!b.data || pos > b.dataLen || len > b.dataLen - pos)
+        return false;
+    size_t fileOffset = b.dataOffset + pos;
+    if (fileOffset + len + SIZE_HASH > store.image.size())
+        return false;
+    uint8_t* out = store.image.data() + fileOffset;
+    b.cryptPayloadRange(out, b.data + pos, pos, len);
+    cryptStaticXorpadBytes(out, len, fileOffset);
+    return true;
+}
+
+void SwishCrypto::refreshImageHash(SCBlockStore& store, size_t from) {
+    constexpr size_t INTERVAL = SCBlockStore::HASH_CHECKPOINT_INTERVAL;
+    if (store.image.size() < SIZE_HASH)
+        return;
+    size_t payloadLen = store.image.size() - SIZE_HASH;
+
+    // Deferred by a mapped load; recorded now they are already current.
+    if (store.hashCheckpoints.empty())
+        recordHashCheckpoints(store, payloadLen);
+
+    // Checkpoints past the first changed byte are stale; refresh them on
+    // the way to the trailer.
+    SHA256_CTX ctx;
+    for (size_t pos = beginHash(store, from, &ctx); pos < payloadLen; pos += INTERVAL) {
+        size_t n = std::min(INTERVAL, payloadLen - pos);
+        sha256_update(&ctx, store.image.data() + pos, n);
+        size_t cpIdx = (pos + n) / INTERVAL;
+        if (n == INTERVAL && cpIdx < store.hashCheckpoints.size())
+            std::memcpy(store.hashCheckpoints[cpIdx].state, ctx.state, sizeof(ctx.state));
     }
-    return nullptr;
+    sha256_update(&ctx, OUTRO_HASH, 64);
+    sha256_final(&ctx, store.image.data() + payloadLen);
+}
+
+SCBlock* SwishCrypto::findBlock(SCBlockStore& store, uint32_t key) {
+    const SCBlockKeyIndex* e = lookupKey(store, key);
+    return e ? &store.blocks[e->block] : nullptr;
+}
+
+const SCBlock* SwishCrypto::findBlock(const SCBlockStore& store, uint32_t key) {
+    const SCBlockKeyIndex* e = lookupKey(store, key);
+    return e ? &store.blocks[e->block] : nullptr;
 }
@@ -332,22 +332,16 @@ void UI::run(const std::string& basePath, const std::string& savePath) {
         showWorking("Loading save data...");
         save_.setGameType(GameType::ZA);
         savePath_ = basePath_ + "main";
-        if (save_.load(savePath_)) {
-            std::string rtResult = save_.verifyRoundTrip();
-            if (rtResult != "OK")
-                showMessageAndWait("Round-Trip Check", rtResult);
-        }
+        if (save_.load(savePath_))
+            save_.startVerify();
         screen_ = AppScreen::MainView;
     }
 #else
     // PC: load save directly
     save_.setGameType(GameType::ZA);
     savePath_ = basePath_ + "main";
-    if (save_.load(savePath_)) {
-        std::string rtResult = save_.verifyRoundTrip();
-        if (rtResult != "OK")
-            showMessageAndWait("Round-Trip Check", rtResult);
-    }
+    if (save_.load(savePath_))
+        save_.startVerify();
     screen_ = AppScreen::MainView;
 #endif
 
@@ -393,6 +387,11 @@ void UI::run(const std::string& basePath, const std::string& savePath) {
             continue;
         }
 
+        // The round-trip check started at load reports here when it finishes.
+        std::string rtResult;
+        if (save_.pollVerify(rtResult) && rtResult != "OK")
+            showMessageAndWait("Round-Trip Check", rtResult);
+
         AppScreen screenBefore = screen_;
         if (screen_ == AppScreen::ProfileSelector) {
             handleProfileSelectorInput(running);
@@ -400,14 +399,17 @@ void UI::run(const std::string& basePath, const std::string& savePath) {
         } else {
             handleDonutInput(running);
             if (saveNow_) {
-                showWorking("Saving...");
-                ledBlink();
-                if (save_.isLoaded())
+                // Nothing changed since load/save: skip the write and commit.
+                if (save_.isLoaded() && save_.hasUnsavedChanges()) {
+                    showWorking("Saving...");
+                    ledBlink();
                     save_.save(savePath_);
-                account_.commitSave();
-                ledOff();
+                    account_.commitSave();
+                    ledOff();
+                }
                 saveNow_ = false;
             }
+            refreshAudit();
             if (screen_ == screenBefore) {
                 SDL_SetRenderDrawColor(renderer_, COL_BG.r, COL_BG.g, COL_BG.b, 255);
                 SDL_RenderClear(renderer_);
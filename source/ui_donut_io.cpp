@@ -189,3 +189,44 @@ bool UI::importDonut(const std::string& filename) {
     showMessageAndWait("Imported", "Loaded into slot #" + std::to_string(listCursor_ + 1));
     return true;
 }
+
+// --- Save Patches ---
+
+// One patch file per app folder; exporting again replaces it.
+static const char* PATCH_FILENAME = "donuts.pkbp";
+
+bool UI::exportSavePatch() {
+    std::string path = basePath_ + PATCH_FILENAME;
+
+    FILE* check = fopen(path.c_str(), "rb");
+    if (check) {
+        fclose(check);
+        if (!showConfirm("Overwrite?", "Patch file already exists:", PATCH_FILENAME))
+            return false;
+    }
+
+    if (!save_.exportPatch(path)) {
+        showMessageAndWait("Export Error", "Failed to write patch file.");
+        return false;
+    }
+    showMessageAndWait("Exported", "Changes since load saved as:", PATCH_FILENAME);
+    return true;
+}
+
+bool UI::applySavePatch() {
+    std::string path = basePath_ + PATCH_FILENAME;
+
+    FILE* check = fopen(path.c_str(), "rb");
+    if (!check) {
+        showMessageAndWait("No Patch", std::string("No ") + PATCH_FILENAME + " found in the app folder.");
+        return false;
+    }
+    fclose(check);
+
+    if (!save_.applyPatch(path)) {
+        showMessageAndWait("Patch Error", "Invalid patch, or it does not fit this save.");
+        return false;
+    }
+    showMessageAndWait("Patch Applied", "Save to write the changes to the game.");
+    return true;
+}
@@ -289,7 +289,9 @@ void UI::handleListInput(int button, bool& running) {
             break;
 
         case SDL_CONTROLLER_BUTTON_A: // Switch B = back to profile selector
-            if (showConfirm("Go Back?", "Unsaved changes will be lost.")) {
+            // Only ask when leaving would actually drop something.
+            if (!(save_.isLoaded() && save_.hasUnsavedChanges()) ||
+                showConfirm("Go Back?", "Unsaved changes will be lost.")) {
                 clearMultiSelect();
                 clearTextCache();
                 account_.unmountSave();
@@ -388,13 +390,13 @@ void UI::handleBatchInput(int button) {
                             for (int i = 0; i < Donut9a::MAX_COUNT; i++) {
                                 if (multiSelected_[i]) {
                                     Donut9a d = save_.getDonut(i);
-                                    if (d.data) DonutInfo::fillOneShiny(d);
+                                    if (d.data) DonutInfo::fillOneShiny(d, bd);
                                 }
                             }
                             clearMultiSelect();
                         } else {
                             Donut9a d = save_.getDonut(listCursor_);
-                            if (d.data) DonutInfo::fillOneShiny(d);
+                            if (d.data) DonutInfo::fillOneShiny(d, bd);
                         }
                         break;
                     }
@@ -403,13 +405,13 @@ void UI::handleBatchInput(int button) {
                             for (int i = 0; i < Donut9a::MAX_COUNT; i++) {
                                 if (multiSelected_[i]) {
                                     Donut9a d = save_.getDonut(i);
-                                    if (d.data) DonutInfo::fillOneShinyRandom(d);
+                                    if (d.data) DonutInfo::fillOneShinyRandom(d, bd);
                                 }
                             }
                             clearMultiSelect();
                         } else {
                             Donut9a d = save_.getDonut(listCursor_);
-                            if (d.data) DonutInfo::fillOneShinyRandom(d);
+                            if (d.data) DonutInfo::fillOneShinyRandom(d, bd);
                         }
                         break;
                     }
@@ -418,13 +420,13 @@ void UI::handleBatchInput(int button) {
                             for (int i = 0; i < Donut9a::MAX_COUNT; i++) {
                                 if (multiSelected_[i]) {
                                     Donut9a d = save_.getDonut(i);
-                                    if (d.data) DonutInfo::fillOneRandomLv3(d);
+                                    if (d.data) DonutInfo::fillOneRandomLv3(d, bd);
                                 }
                             }
                             clearMultiSelect();
                         } else {
                             Donut9a d = save_.getDonut(listCursor_);
-                            if (d.data) DonutInfo::fillOneRandomLv3(d);
+                            if (d.data) DonutInfo::fillOneRandomLv3(d, bd);
                         }
                         break;
                     }
@@ -472,6 +474,12 @@ void UI::handleBatchInput(int button) {
                             return;
                         }
                         break;
+                    case BatchOp::ExportPatch:
+                        exportSavePatch();
+                        break;
+                    case BatchOp::ApplyPatch:
+                        applySavePatch();
+                        break;
                     case BatchOp::Cancel:
                         break;
                     default: break;
@@ -618,12 +626,13 @@ void UI::handleExitMenuInput(int button, bool& running) {
                 saveNow_ = true;
                 running = false;
             } else if (op == ExitOp::SaveAndBack) {
-                showWorking("Saving...");
-                ledBlink();
-                if (save_.isLoaded())
+                if (save_.isLoaded() && save_.hasUnsavedChanges()) {
+                    showWorking("Saving...");
+                    ledBlink();
                     save_.save(savePath_);
-                account_.commitSave();
-                ledOff();
+                    account_.commitSave();
+                    ledOff();
+                }
                 clearTextCache();
                 account_.unmountSave();
                 screen_ = AppScreen::ProfileSelector;
@@ -666,6 +675,27 @@ void UI::applyToMultiSelected(int sourceIdx) {
     }
 }
 
+// --- Legality Audit ---
+
+void UI::refreshAudit() {
+    const uint8_t* bd = save_.donutBlockData();
+    if (!bd)
+        return;
+    constexpr size_t len = Donut9a::MAX_COUNT * Donut9a::SIZE;
+    bool full = auditedDonuts_.size() != len;
+    bool dirty[Donut9a::MAX_COUNT];
+    bool any = false;
+    for (int i = 0; i < Donut9a::MAX_COUNT; i++) {
+        size_t pos = static_cast<size_t>(i) * Donut9a::SIZE;
+        dirty[i] = full || std::memcmp(bd + pos, auditedDonuts_.data() + pos, Donut9a::SIZE) != 0;
+        any |= dirty[i];
+    }
+    if (!any)
+        return;
+    DonutInfo::auditPocket(bd, donutIssues_, full ? nullptr : dirty);
+    auditedDonuts_.assign(bd, bd + len);
+}
+
 int UI::totalPages() {
     int visibleRows = (CONTENT_H - 28) / ROW_H;
     if (visibleRows <= 0) return 1;
@@ -213,10 +213,9 @@ void UI::selectProfile(int index) {
         return;
     }
 
-    // Verify encryption round-trip
-    std::string rtResult = save_.verifyRoundTrip();
-    if (rtResult != "OK")
-        showMessageAndWait("Round-Trip Check", rtResult);
+    // Verify encryption round-trip in the background; the main loop
+    // reports a failure once the check finishes.
+    save_.startVerify();
 
     // Reset donut editor state
     listCursor_ = 0;
@@ -224,6 +223,7 @@ void UI::selectProfile(int index) {
     editField_ = 0;
     batchCursor_ = 0;
     state_ = UIState::List;
+    auditedDonuts_.clear();
     clearTextCache();
 
     screen_ = AppScreen::MainView;
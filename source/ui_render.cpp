@@ -3,6 +3,7 @@
 #include <cstring>
 #include <cmath>
 #include <ctime>
+#include <iterator>
 
 // --- Sprite Cache ---
 
@@ -284,6 +285,10 @@ void UI::drawDonutHeader() {
         drawTextRight(buf, SCREEN_W - 20, 14, multiSelectCount_ > 0 ? COL_ACCENT : COL_TEXT_DIM, font_);
     }
 
+    if (save_.hasUnsavedChanges()) {
+        int titleW = getTextTexture(APP_TITLE, fontLarge_, COL_CURSOR).w;
+        drawText("* Unsaved changes", 20 + titleW + 20, 14, COL_ACCENT, font_);
+    }
 }
 
 // --- Donut Editor: Status Bar ---
@@ -393,6 +398,9 @@ void UI::drawListPanel() {
             char fbuf[4];
             std::snprintf(fbuf, sizeof(fbuf), "%d", d.flavorCount());
             drawText(fbuf, LIST_X + 370, ry + 6, COL_ACCENT, fontSmall_);
+
+            if (donutIssues_[idx])
+                drawText("!", LIST_X + 405, ry + 6, COLOR_RED, fontSmall_);
         } else {
             SDL_Color emptyCol = isCursor ? COL_TEXT_DIM : isMultiSel ? COL_TEXT_DIM : COL_EMPTY;
             char ibuf[8];
@@ -496,6 +504,26 @@ void UI::drawDetailPanel() {
         }
     }
 
+    uint8_t issues = donutIssues_[listCursor_];
+    if (issues) {
+        // Indexed by DonutIssue bit.
+        static const char* ISSUE_NAMES[] = {
+            "bad berry", "bad flavor", "stats mismatch",
+            "bad date", "duplicate timestamp", "reserved bytes set",
+        };
+        static_assert(std::size(ISSUE_NAMES) == DonutIssue::COUNT);
+        std::string text = "Issues:";
+        bool first = true;
+        for (size_t i = 0; i < std::size(ISSUE_NAMES); i++) {
+            if (issues & (1 << i)) {
+                text += first ? " " : ", ";
+                text += ISSUE_NAMES[i];
+                first = false;
+            }
+        }
+        drawText(text, px + 20, y + 22, COLOR_RED, fontSmall_);
+    }
+
     // Flavor radar chart (right side of detail panel)
     int flavorVals[5];
     DonutInfo::calcFlavorProfile(d, flavorVals);
@@ -601,13 +629,15 @@ static const char* BATCH_LABELS[] = {
     "Compress (remove gaps)",
     "Export Donut to File",
     "Import Donut from File",
+    "Export Changes as Patch",
+    "Apply Patch File",
     "Cancel",
 };
 
 void UI::drawBatchMenu() {
     drawRect(0, 0, SCREEN_W, SCREEN_H, {0, 0, 0, 140});
 
-    int mw = 380, mh = 462;
+    int mw = 380, mh = 526;
     int mx = (SCREEN_W - mw) / 2;
     int my = (SCREEN_H - mh) / 2;
 
@@ -0,0 +1,510 @@
+#include "swish_crypto.h"
+#include "sha256.h"
+#include "save_patch.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::mt19937_64 rng(0x5EED);
+
+// --- Heap accounting: every operator new in the process is counted ---
+
+static size_t g_allocs = 0;
+static size_t g_liveBytes = 0;
+static size_t g_peakBytes = 0;
+
+// Each allocation carries its size in front so delete can take it back off
+// the live total.
+static constexpr size_t ALLOC_HEADER = alignof(std::max_align_t);
+
+void* operator new(size_t size) {
+    auto* p = static_cast<uint8_t*>(std::malloc(size + ALLOC_HEADER));
+    if (!p)
+        throw std::bad_alloc();
+    std::memcpy(p, &size, sizeof(size));
+    g_allocs++;
+    g_liveBytes += size;
+    g_peakBytes = std::max(g_peakBytes, g_liveBytes);
+    return p + ALLOC_HEADER;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr)
+        return;
+    // Through uintptr_t: GCC otherwise flags the step back out of the
+    // object it sees being freed.
+    auto* p = reinterpret_cast<uint8_t*>(reinterpret_cast<uintptr_t>(ptr) - ALLOC_HEADER);
+    size_t size;
+    std::memcpy(&size, p, sizeof(size));
+    g_liveBytes -= size;
+    std::free(p);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
+
+// --- Static xorpad: vector kernel against a byte loop ---
+
+static uint8_t g_pad[127];
+
+// The pad itself, read back one byte at a time (the kernel's scalar tail).
+static void loadPad() {
+    for (size_t i = 0; i < sizeof(g_pad); i++) {
+        g_pad[i] = 0;
+        SwishCrypto::cryptStaticXorpadBytes(&g_pad[i], 1, i);
+    }
+}
+
+static void xorpadByteLoop(uint8_t* data, size_t len, size_t fileOffset) {
+    for (size_t i = 0; i < len; i++)
+        data[i] ^= g_pad[(fileOffset + i) % sizeof(g_pad)];
+}
+
+static void testXorpad() {
+    loadPad();
+    for (int t = 0; t < 2000; t++) {
+        size_t len = rng() % (t < 1000 ? 600 : 20000);
+        size_t offset = rng() % 100000;
+        std::vector<uint8_t> a(len), b;
+        for (auto& x : a)
+            x = static_cast<uint8_t>(rng());
+        b = a;
+        SwishCrypto::cryptStaticXorpadBytes(a.data(), len, offset);
+        xorpadByteLoop(b.data(), len, offset);
+        CHECK(a == b);
+    }
+
+    std::vector<uint8_t> big(8 << 20, 0x5A);
+    double kernel = bestMicros(10, [&] { SwishCrypto::cryptStaticXorpadBytes(big.data(), big.size()); });
+    double loop = bestMicros(10, [&] { xorpadByteLoop(big.data(), big.size(), 0); });
+    std::printf("xorpad 8 MB: kernel %.0f us, byte loop %.0f us (%.1fx)\n",
+                kernel, loop, loop / kernel);
+}
+
+// --- SCXorShift32: jump and skip against stepping ---
+
+static bool sameStream(SCXorShift32 a, SCXorShift32 b) {
+    for (int i = 0; i < 64; i++)
+        if (a.next() != b.next())
+            return false;
+    return true;
+}
+
+static void testJump() {
+    for (int t = 0; t < 300; t++) {
+        auto seed = static_cast<uint32_t>(rng());
+        uint64_t n = t < 100 ? rng() % 64 : rng() % 200000;
+        int phase = static_cast<int>(rng() % 4);
+
+        SCXorShift32 jumped(seed), stepped(seed);
+        for (int i = 0; i < phase; i++) {
+            jumped.next();
+            stepped.next();
+        }
+        jumped.jump(n);
+        for (uint64_t i = 0; i < n; i++)
+            stepped.nextWord();
+        CHECK(sameStream(jumped, stepped));
+
+        SCXorShift32 skipped(seed), byteStepped(seed);
+        size_t bytes = n + phase;
+        skipped.skip(bytes);
+        for (size_t i = 0; i < bytes; i++)
+            byteStepped.next();
+        CHECK(sameStream(skipped, byteStepped));
+    }
+
+    // A payload range decrypts like the same slice of the whole payload.
+    SCBlock b{};
+    b.key = 0x12345678;
+    b.type = SCTypeCode::Object;
+    b.offset = 100;
+    b.dataOffset = 109;
+    b.dataLen = 70000;
+    std::vector<uint8_t> src(b.dataLen), whole(b.dataLen);
+    for (auto& x : src)
+        x = static_cast<uint8_t>(rng());
+    b.cryptPayload(whole.data(), src.data());
+    for (int t = 0; t < 200; t++) {
+        size_t pos = rng() % b.dataLen;
+        size_t len = rng() % (b.dataLen - pos + 1);
+        std::vector<uint8_t> part(len);
+        b.cryptPayloadRange(part.data(), src.data() + pos, pos, len);
+        CHECK(std::memcmp(part.data(), whole.data() + pos, len) == 0);
+    }
+
+    const uint64_t far = (1 << 20) - 1; // every bit set: the slowest jump of its size
+    SCXorShift32 x(0xBEEF);
+    double jump = bestMicros(10, [&] { x.jump(far); });
+    double step = bestMicros(3, [&] {
+        for (uint64_t i = 0; i < far; i++)
+            x.nextWord();
+    });
+    std::printf("xorshift 4 MB ahead: jump %.2f us, stepping %.0f us (state %08x)\n",
+                jump, step, x.nextWord());
+}
+
+// --- SHA-256: known answers for every backend ---
+
+static std::string hex(const uint8_t* h) {
+    std::string s;
+    char b[3];
+    for (int i = 0; i < 32; i++) {
+        std::snprintf(b, sizeof(b), "%02x", h[i]);
+        s += b;
+    }
+    return s;
+}
+
+// Digest of data fed in two uneven updates, so both the buffered and the
+// whole-block paths of sha256_update are used.
+static std::string digest(const uint8_t* data, size_t len) {
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, len / 3);
+    sha256_update(&ctx, data + len / 3, len - len / 3);
+    uint8_t h[32];
+    sha256_final(&ctx, h);
+    return hex(h);
+}
+
+static void testSha256() {
+    std::string million(1000000, 'a');
+    const struct { std::string msg; const char* expected; } kats[] = {
+        {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+        {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+        {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+         "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+        {million, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+    };
+
+    std::vector<uint8_t> big(8 << 20);
+    for (auto& x : big)
+        x = static_cast<uint8_t>(rng());
+
+    const SHA256Backend& active = sha256ActiveBackend();
+    std::printf("sha256 active backend: %s\n", active.name);
+    int count;
+    const SHA256Backend* backends = sha256Backends(count);
+    std::string reference;
+    for (int i = 0; i < count; i++) {
+        const SHA256Backend& b = backends[i];
+        if (!b.supported()) {
+            std::printf("sha256 %s: not supported on this CPU, skipped\n", b.name);
+            continue;
+        }
+        sha256SetBackend(b);
+        for (const auto& k : kats)
+            CHECK(digest(reinterpret_cast<const uint8_t*>(k.msg.data()), k.msg.size()) == k.expected);
+
+        std::string d;
+        double us = bestMicros(5, [&] { d = digest(big.data(), big.size()); });
+        if (reference.empty())
+            reference = d;
+        CHECK(d == reference);
+        std::printf("sha256 %s: %.0f MB/s\n", b.name, big.size() / us);
+    }
+    sha256SetBackend(active);
+}
+
+// --- Save round trip: encrypt, encryptStream and patchImage agree ---
+
+static constexpr uint32_t EDIT_KEY = 0xBE007476;
+
+// A synthetic save: a few thousand blocks of mixed types around one large
+// Object block shaped like the donut block. The blocks are written with a
+// placeholder trailer, then encrypted with every block dirty so the
+// trailer is computed.
+static std::vector<uint8_t> makeSave() {
+    std::vector<SCBlock> blocks;
+    std::vector<std::vector<uint8_t>> payloads;
+    const int count = 3000;
+    for (int i = 0; i < count; i++) {
+        SCBlock b{};
+        b.key = i == count / 2 ? EDIT_KEY : static_cast<uint32_t>(rng());
+        size_t len = 0;
+        switch (i == count / 2 ? 6 : rng() % 5) {
+            case 0: b.type = SCTypeCode::Bool1; break;
+            case 1: b.type = SCTypeCode::UInt64; len = 8; break;
+            case 2: b.type = SCTypeCode::Int16; len = 2; break;
+            case 3: b.type = SCTypeCode::Array; b.subType = SCTypeCode::UInt32;
+                    len = 4 * (rng() % 300); break;
+            case 4: b.type = SCTypeCode::Object; len = rng() % 700; break;
+            default: b.type = SCTypeCode::Object; len = 999 * 72; break;
+        }
+        b.dataLen = len;
+        payloads.emplace_back(len);
+        for (auto& x : payloads.back())
+            x = static_cast<uint8_t>(rng());
+        blocks.push_back(b);
+    }
+
+    size_t payloadLen = 0;
+    for (auto& b : blocks)
+        payloadLen += b.encodedSize();
+    std::vector<uint8_t> image(payloadLen + 32);
+    size_t offset = 0;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        blocks[i].data = payloads[i].data();
+        offset += blocks[i].writeBlock(image.data() + offset);
+    }
+    SwishCrypto::cryptStaticXorpadBytes(image.data(), payloadLen);
+
+    SCBlockStore store = SwishCrypto::decrypt(std::move(image));
+    for (auto& b : store.blocks)
+        b.dirty = true;
+    return SwishCrypto::encrypt(store);
+}
+
+static std::vector<uint8_t> streamed(const SCBlockStore& store, const SCBlock* substitute) {
+    std::vector<uint8_t> out;
+    bool ok = SwishCrypto::encryptStream(store, [&](const uint8_t* data, size_t len) {
+        out.insert(out.end(), data, data + len);
+        return true;
+    }, substitute);
+    CHECK(ok);
+    return out;
+}
+
+static bool imageEquals(const SCBlockStore& store, const std::vector<uint8_t>& file) {
+    return store.image.size() == file.size() &&
+           std::memcmp(store.image.data(), file.data(), file.size()) == 0;
+}
+
+static void testRoundTrip() {
+    const std::vector<uint8_t> file = makeSave();
+    CHECK(!file.empty());
+
+    // Clean stores re-encrypt to the file in either mode.
+    for (auto mode : {SwishCrypto::DecryptMode::Full, SwishCrypto::DecryptMode::Lazy}) {
+        SCBlockStore store = SwishCrypto::decrypt(file, mode);
+        CHECK(SwishCrypto::encrypt(store) == file);
+        CHECK(streamed(store, nullptr) == file);
+    }
+
+    // Edit a few 72-byte slots of the large block.
+    SCBlockStore store = SwishCrypto::decrypt(file, SwishCrypto::DecryptMode::Lazy);
+    SCBlock* b = SwishCrypto::findBlock(store, EDIT_KEY);
+    CHECK(b != nullptr);
+    if (!b)
+        return;
+    uint8_t* data = store.data(*b);
+    std::vector<size_t> slots;
+    for (int i = 0; i < 5; i++)
+        slots.push_back((rng() % 999) * 72);
+    std::sort(slots.begin(), slots.end());
+    for (size_t pos : slots)
+        for (size_t i = 0; i < 72; i++)
+            data[pos + i] = static_cast<uint8_t>(rng());
+    b->dirty = true;
+
+    std::vector<uint8_t> edited = SwishCrypto::encrypt(store);
+    CHECK(edited.size() == file.size());
+    CHECK(edited != file);
+    CHECK(streamed(store, nullptr) == edited);
+
+    // The same edits as a substitute for a clean store's block.
+    SCBlockStore clean = SwishCrypto::decrypt(file, SwishCrypto::DecryptMode::Lazy);
+    CHECK(streamed(clean, b) == edited);
+
+    // The same edits patched into the image slot by slot.
+    SCBlock* p = SwishCrypto::findBlock(clean, EDIT_KEY);
+    std::memcpy(clean.data(*p), data, p->dataLen);
+    for (size_t pos : slots)
+        CHECK(SwishCrypto::patchImage(clean, *p, pos, 72));
+    SwishCrypto::refreshImageHash(clean, p->dataOffset + slots.front());
+    CHECK(imageEquals(clean, edited));
+
+    // And the edited file decrypts back to the edits.
+    SCBlockStore reloaded = SwishCrypto::decrypt(edited, SwishCrypto::DecryptMode::Full);
+    const SCBlock* r = SwishCrypto::findBlock(reloaded, EDIT_KEY);
+    CHECK(r && std::memcmp(r->data, data, r->dataLen) == 0);
+
+    double one = bestMicros(10, [&] { SwishCrypto::encrypt(store); });
+    for (auto& x : reloaded.blocks)
+        x.dirty = true;
+    double all = bestMicros(10, [&] { SwishCrypto::encrypt(reloaded); });
+    std::printf("encrypt %zu KB: one dirty block %.0f us, every block dirty %.0f us\n",
+                file.size() >> 10, one, all);
+}
+
+// --- Save patches: serialize/parse round trip, malformed input, diff runs ---
+
+static bool sameEntries(const std::vector<SavePatch::Entry>& a, const std::vector<SavePatch::Entry>& b) {
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].key != b[i].key || a[i].offset != b[i].offset || a[i].bytes != b[i].bytes)
+            return false;
+    }
+    return true;
+}
+
+static void testSavePatch() {
+    std::vector<SavePatch::Entry> entries = {
+        {EDIT_KEY, 0, {1, 2, 3}},
+        {0x12345678, 72 * 998, std::vector<uint8_t>(72, 0xAB)},
+        {EDIT_KEY, 500, {}},
+    };
+    std::vector<uint8_t> patch = SavePatch::serialize(entries);
+    std::vector<SavePatch::Entry> parsed;
+    CHECK(SavePatch::parse(patch.data(), patch.size(), parsed));
+    CHECK(sameEntries(parsed, entries));
+
+    // Every truncation fails, and so does trailing data.
+    bool anyParsed = false;
+    for (size_t len = 0; len < patch.size(); len++)
+        anyParsed |= SavePatch::parse(patch.data(), len, parsed);
+    CHECK(!anyParsed);
+    std::vector<uint8_t> longer = patch;
+    longer.push_back(0);
+    CHECK(!SavePatch::parse(longer.data(), longer.size(), parsed));
+
+    // A count that does not match the entries, a wrong magic or version.
+    for (uint32_t count : {2u, 4u, 0xFFFFFFFFu}) {
+        std::vector<uint8_t> bad = patch;
+        std::memcpy(bad.data() + 8, &count, 4);
+        CHECK(!SavePatch::parse(bad.data(), bad.size(), parsed));
+    }
+    std::vector<uint8_t> badMagic = patch;
+    badMagic[0] ^= 1;
+    CHECK(!SavePatch::parse(badMagic.data(), badMagic.size(), parsed));
+    std::vector<uint8_t> badVersion = patch;
+    badVersion[4]++;
+    CHECK(!SavePatch::parse(badVersion.data(), badVersion.size(), parsed));
+
+    // Runs closer than an entry header (12 bytes) merge; further apart
+    // they stay separate.
+    std::vector<uint8_t> base(200, 0), cur(200, 0);
+    cur[10] = cur[22] = 1;   // 11 equal bytes between: one entry
+    cur[100] = cur[113] = 1; // 12 equal bytes between: two entries
+    cur[199] = 1;
+    std::vector<SavePatch::Entry> runs;
+    SavePatch::diff(runs, EDIT_KEY, base.data(), cur.data(), base.size());
+    CHECK(runs.size() == 4);
+    if (runs.size() == 4) {
+        CHECK(runs[0].offset == 10 && runs[0].bytes.size() == 13);
+        CHECK(runs[1].offset == 100 && runs[1].bytes.size() == 1);
+        CHECK(runs[2].offset == 113 && runs[2].bytes.size() == 1);
+        CHECK(runs[3].offset == 199 && runs[3].bytes.size() == 1);
+    }
+    for (const auto& e : runs)
+        std::memcpy(base.data() + e.offset, e.bytes.data(), e.bytes.size());
+    CHECK(base == cur);
+}
+
+// --- Payload arena: allocations and peak heap against per-block vectors ---
+
+struct HeapUse {
+    size_t allocs;
+    size_t peak;
+};
+
+// Runs f from a clean count; peak is the most f ever had live at once.
+template <typename F>
+static HeapUse heapUse(F f) {
+    size_t allocs = g_allocs;
+    size_t live = g_liveBytes;
+    g_peakBytes = live;
+    f();
+    return {g_allocs - allocs, g_peakBytes - live};
+}
+
+static void testArena() {
+    const std::vector<uint8_t> file = makeSave();
+
+    // What every block owning its payload costs: one vector per block,
+    // as the store held them before the arena.
+    std::vector<std::vector<uint8_t>> payloads;
+    HeapUse perBlock = heapUse([&] {
+        SCBlockStore store = SwishCrypto::decrypt(file, SwishCrypto::DecryptMode::Lazy);
+        std::vector<std::vector<uint8_t>> v;
+        v.reserve(store.blocks.size());
+        for (auto& b : store.blocks) {
+            auto& p = v.emplace_back(store.image.data() + b.dataOffset,
+                                     store.image.data() + b.dataOffset + b.dataLen);
+            SwishCrypto::cryptStaticXorpadBytes(p.data(), p.size(), b.dataOffset);
+            b.cryptPayload(p.data(), p.data());
+        }
+        payloads = std::move(v);
+    });
+
+    SCBlockStore reference = SwishCrypto::decrypt(file, SwishCrypto::DecryptMode::Full);
+    CHECK(payloads.size() == reference.blocks.size());
+    for (size_t i = 0; i < payloads.size() && i < reference.blocks.size(); i++)
+        CHECK(std::memcmp(payloads[i].data(), reference.blocks[i].data, payloads[i].size()) == 0);
+    size_t blockCount = payloads.size();
+    payloads.clear();
+
+    HeapUse full = heapUse([&] { SwishCrypto::decrypt(file, SwishCrypto::DecryptMode::Full); });
+    HeapUse lazyAll = heapUse([&] {
+        SCBlockStore store = SwishCrypto::decrypt(file, SwishCrypto::DecryptMode::Lazy);
+        for (auto& b : store.blocks)
+            store.data(b);
+    });
+    HeapUse lazyOne = heapUse([&] {
+        SCBlockStore store = SwishCrypto::decrypt(file, SwishCrypto::DecryptMode::Lazy);
+        store.data(*SwishCrypto::findBlock(store, EDIT_KEY));
+    });
+
+    // Full takes one slab. Lazy opens a slab per 64 KB of payload, or
+    // early when a block does not fit the rest of one, so about two per
+    // 64 KB at most.
+    CHECK(full.allocs < 16);
+    CHECK(lazyAll.allocs <= full.allocs + 2 * file.size() / 0x10000 + 1);
+    CHECK(perBlock.allocs > blockCount / 2);
+
+    std::printf("heap %zu blocks: per-block vectors %zu allocs"
+                " %zu KB peak; arena Full %zu allocs %zu KB peak, Lazy every block %zu allocs"
+                " %zu KB peak, Lazy one block %zu allocs %zu KB peak\n",
+                blockCount, perBlock.allocs, perBlock.peak >> 10, full.allocs, full.peak >> 10,
+                lazyAll.allocs, lazyAll.peak >> 10, lazyOne.allocs, lazyOne.peak >> 10);
+}
+
+// --- Corrupt headers: lengths that run past the payload are rejected ---
+
+// One Object block claiming len payload bytes, followed by avail bytes and
+// the hash trailer, padded like a file on disk.
+static std::vector<uint8_t> probeImage(size_t len, size_t avail) {
+    SCBlock b{};
+    b.key = 0x1234ABCD;
+    b.type = SCTypeCode::Object;
+    b.dataLen = len;
+    std::vector<uint8_t> image(SCBlock::MAX_HEADER_SIZE + avail + 32);
+    SCXorShift32 xk(b.key);
+    size_t hdrLen = b.writeHeader(image.data(), xk);
+    image.resize(hdrLen + avail + 32);
+    SwishCrypto::cryptStaticXorpadBytes(image.data(), hdrLen + avail);
+    return image;
+}
+
+static void testCorruptHeader() {
+    for (auto mode : {SwishCrypto::DecryptMode::Full, SwishCrypto::DecryptMode::Lazy}) {
+        // A well-formed block decodes.
+        CHECK(SwishCrypto::decrypt(probeImage(16, 16), mode).blocks.size() == 1);
+        // Length -8, length past the end, and a header cut short.
+        CHECK(SwishCrypto::decrypt(probeImage(static_cast<size_t>(-8), 16), mode).blocks.empty());
+        CHECK(SwishCrypto::decrypt(probeImage(17, 16), mode).blocks.empty());
+        std::vector<uint8_t> cut = probeImage(0, 0);
+        cut.erase(cut.begin() + 6, cut.end() - 32);
+        CHECK(SwishCrypto::decrypt(cut, mode).blocks.empty());
+    }
+}
+
+int main() {
+    testXorpad();
+    testJump();
+    testSha256();
+    testRoundTrip();
+    testSavePatch();
+    testArena();
+    testCorruptHeader();
+    return testResult("test_crypto");
+}
@@ -0,0 +1,451 @@
+#include "donut.h"
+#include "test_util.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <vector>
+
+static std::mt19937_64 rng(0xD0);
+static volatile long g_sink; // keeps benchmark results live
+
+// --- Berry lookup: dense index against a linear scan ---
+
+static int berryLinear(uint16_t item) {
+    for (int i = 0; i < DonutInfo::BERRY_COUNT; i++)
+        if (DonutInfo::BERRIES[i].item == item)
+            return i;
+    return -1;
+}
+
+static int validBerryLinear(uint16_t item) {
+    for (int i = 0; i < DonutInfo::VALID_BERRY_COUNT; i++)
+        if (DonutInfo::VALID_BERRY_IDS[i] == item)
+            return i;
+    return 0;
+}
+
+static bool endsWith(const char* s, const char* suffix) {
+    size_t n = std::strlen(s), m = std::strlen(suffix);
+    return n >= m && std::strcmp(s + n - m, suffix) == 0;
+}
+
+// getBerryName() as a switch over every item, before the dense index.
+static const struct {
+    uint16_t item;
+    const char* name;
+} BASELINE_BERRY_NAMES[] = {
+    {0, "(none)"},
+    {149, "Cheri Berry"},
+    {150, "Chesto Berry"},
+    {151, "Pecha Berry"},
+    {152, "Rawst Berry"},
+    {153, "Aspear Berry"},
+    {155, "Oran Berry"},
+    {156, "Persim Berry"},
+    {157, "Lum Berry"},
+    {158, "Sitrus Berry"},
+    {169, "Pomeg Berry"},
+    {170, "Kelpsy Berry"},
+    {171, "Qualot Berry"},
+    {172, "Hondew Berry"},
+    {173, "Grepa Berry"},
+    {174, "Tamato Berry"},
+    {184, "Occa Berry"},
+    {185, "Passho Berry"},
+    {186, "Wacan Berry"},
+    {187, "Rindo Berry"},
+    {188, "Yache Berry"},
+    {189, "Chople Berry"},
+    {190, "Kebia Berry"},
+    {191, "Shuca Berry"},
+    {192, "Coba Berry"},
+    {193, "Payapa Berry"},
+    {194, "Tanga Berry"},
+    {195, "Charti Berry"},
+    {196, "Kasib Berry"},
+    {197, "Haban Berry"},
+    {198, "Colbur Berry"},
+    {199, "Babiri Berry"},
+    {200, "Chilan Berry"},
+    {686, "Roseli Berry"},
+    {2651, "Hyper Cheri Berry"},
+    {2652, "Hyper Chesto Berry"},
+    {2653, "Hyper Pecha Berry"},
+    {2654, "Hyper Rawst Berry"},
+    {2655, "Hyper Aspear Berry"},
+    {2656, "Hyper Oran Berry"},
+    {2657, "Hyper Persim Berry"},
+    {2658, "Hyper Lum Berry"},
+    {2659, "Hyper Sitrus Berry"},
+    {2660, "Hyper Pomeg Berry"},
+    {2661, "Hyper Kelpsy Berry"},
+    {2662, "Hyper Qualot Berry"},
+    {2663, "Hyper Hondew Berry"},
+    {2664, "Hyper Grepa Berry"},
+    {2665, "Hyper Tamato Berry"},
+    {2666, "Hyper Occa Berry"},
+    {2667, "Hyper Passho Berry"},
+    {2668, "Hyper Wacan Berry"},
+    {2669, "Hyper Rindo Berry"},
+    {2670, "Hyper Yache Berry"},
+    {2671, "Hyper Chople Berry"},
+    {2672, "Hyper Kebia Berry"},
+    {2673, "Hyper Shuca Berry"},
+    {2674, "Hyper Coba Berry"},
+    {2675, "Hyper Payapa Berry"},
+    {2676, "Hyper Tanga Berry"},
+    {2677, "Hyper Charti Berry"},
+    {2678, "Hyper Kasib Berry"},
+    {2679, "Hyper Haban Berry"},
+    {2680, "Hyper Colbur Berry"},
+    {2681, "Hyper Babiri Berry"},
+    {2682, "Hyper Chilan Berry"},
+    {2683, "Hyper Roseli Berry"},
+};
+
+static const char* baselineBerryName(uint16_t item) {
+    for (const auto& e : BASELINE_BERRY_NAMES)
+        if (e.item == item)
+            return e.name;
+    return "???";
+}
+
+static void testBerryLookup() {
+    for (uint32_t item = 0; item <= 0xFFFF; item++) {
+        auto id = static_cast<uint16_t>(item);
+        int idx = berryLinear(id);
+        CHECK(DonutInfo::findBerryByItem(id) == idx);
+        CHECK(DonutInfo::findValidBerryIndex(id) == validBerryLinear(id));
+        const char* name = DonutInfo::getBerryName(id);
+        if (idx >= 0)
+            CHECK(endsWith(name, " Berry"));
+        else if (id != 0)
+            CHECK(std::strcmp(name, "???") == 0);
+    }
+    // Every item names the same as under the old switch.
+    bool sameNames = true;
+    for (uint32_t item = 0; item <= 0xFFFF; item++) {
+        auto id = static_cast<uint16_t>(item);
+        sameNames &= std::strcmp(DonutInfo::getBerryName(id), baselineBerryName(id)) == 0;
+    }
+    CHECK(sameNames);
+    CHECK(static_cast<int>(std::size(BASELINE_BERRY_NAMES)) == DonutInfo::BERRY_COUNT + 1);
+
+    // Mostly real berries, as in a pocket, with some unknown IDs.
+    std::vector<uint16_t> items(1 << 16);
+    for (auto& x : items)
+        x = rng() % 4 ? DonutInfo::BERRIES[rng() % DonutInfo::BERRY_COUNT].item
+                      : static_cast<uint16_t>(rng());
+    double index = bestMicros(20, [&] {
+        long sum = 0;
+        for (uint16_t x : items)
+            sum += DonutInfo::findBerryByItem(x);
+        g_sink = sum;
+    });
+    double linear = bestMicros(20, [&] {
+        long sum = 0;
+        for (uint16_t x : items)
+            sum += berryLinear(x);
+        g_sink = sum;
+    });
+    std::printf("berry lookup x%zu: index %.0f us, linear scan %.0f us (%.1fx)\n",
+                items.size(), index, linear, linear / index);
+}
+
+// --- recalcStats: dense index against the linear-scan original ---
+
+// recalcStats() as it was before the dense index: every berry found by a
+// scan of BERRIES.
+static void recalcStatsLinear(Donut9a& d) {
+    int sumBoost = 0, sumCal = 0, flavorScore = 0;
+    int flavors[5] = {};
+    for (int i = 0; i < 8; i++) {
+        int idx = berryLinear(d.berry(i));
+        if (idx < 0) continue;
+        const auto& b = DonutInfo::BERRIES[idx];
+        sumBoost += b.boost;
+        sumCal += b.calories;
+        flavorScore += b.flavorScore();
+        flavors[0] += b.spicy;
+        flavors[1] += b.fresh;
+        flavors[2] += b.sweet;
+        flavors[3] += b.bitter;
+        flavors[4] += b.sour;
+    }
+    uint8_t stars = DonutInfo::calcStarRating(flavorScore);
+    int mult = 10 + stars;
+    int totalBoost = sumBoost * mult / 10;
+    int totalCal = sumCal * mult / 10;
+    d.setCalories(static_cast<uint16_t>(totalCal > 9999 ? 9999 : totalCal));
+    d.setLevelBoost(static_cast<uint8_t>(totalBoost));
+    d.setStars(stars);
+    d.setBerryName(d.berry(0));
+
+    int berryIdx = berryLinear(d.berry(0));
+    if (berryIdx >= 0) {
+        int maxVal = 0, count = 0, variant = 0;
+        for (int f : flavors)
+            maxVal = std::max(maxVal, f);
+        for (int f : flavors)
+            count += f == maxVal;
+        if (maxVal != 0 && count > 1) {
+            variant = 5;
+        } else if (maxVal != 0) {
+            static const int FLAVOR_TO_VARIANT[] = {1, 4, 0, 3, 2};
+            for (int i = 0; i < 5; i++)
+                if (flavors[i] == maxVal) { variant = FLAVOR_TO_VARIANT[i]; break; }
+        }
+        d.setDonutSprite(static_cast<uint16_t>(DonutInfo::BERRIES[berryIdx].donutIdx * 6 + variant));
+    }
+}
+
+static void testRecalcIndex() {
+    // A full pocket of real berries, with some empty slots and unknown IDs.
+    const size_t pocketSize = Donut9a::MAX_COUNT * Donut9a::SIZE;
+    std::vector<uint8_t> indexed(pocketSize), linear;
+    for (auto& x : indexed)
+        x = static_cast<uint8_t>(rng());
+    for (int i = 0; i < Donut9a::MAX_COUNT; i++) {
+        Donut9a d{indexed.data() + i * Donut9a::SIZE};
+        for (int j = 0; j < Donut9a::MAX_BERRIES; j++) {
+            uint32_t r = rng() % 16;
+            d.setBerry(j, r == 0 ? 0 : r == 1 ? static_cast<uint16_t>(rng())
+                                              : DonutInfo::BERRIES[rng() % DonutInfo::BERRY_COUNT].item);
+        }
+    }
+    linear = indexed;
+
+    auto recalcPocket = [](std::vector<uint8_t>& pocket, void (*recalc)(Donut9a&)) {
+        for (int i = 0; i < Donut9a::MAX_COUNT; i++) {
+            Donut9a d{pocket.data() + i * Donut9a::SIZE};
+            recalc(d);
+        }
+    };
+    recalcPocket(indexed, DonutInfo::recalcStats);
+    recalcPocket(linear, recalcStatsLinear);
+    CHECK(indexed == linear);
+
+    double index = bestMicros(50, [&] { recalcPocket(indexed, DonutInfo::recalcStats); });
+    double scan = bestMicros(50, [&] { recalcPocket(linear, recalcStatsLinear); });
+    g_sink = indexed[0x0C] + linear[0x0C];
+    std::printf("recalcStats %d slots: index %.1f us, linear scan %.1f us (%.1fx)\n",
+                Donut9a::MAX_COUNT, index, scan, scan / index);
+}
+
+// --- Flavor lookup: perfect hash against a linear search ---
+
+static int flavorLinear(uint64_t hash) {
+    for (int i = 0; i < DonutInfo::FLAVOR_COUNT; i++)
+        if (DonutInfo::FLAVORS[i].hash == hash)
+            return i;
+    return -1;
+}
+
+static void testFlavorLookup() {
+    for (int i = 0; i < DonutInfo::FLAVOR_COUNT; i++) {
+        uint64_t h = DonutInfo::FLAVORS[i].hash;
+        CHECK(DonutInfo::findFlavorByHash(h) == i);
+        CHECK(std::strcmp(DonutInfo::getFlavorName(h), DonutInfo::FLAVORS[i].name) == 0);
+        // Near misses land in the same buckets as real hashes.
+        for (int bit = 0; bit < 64; bit++) {
+            uint64_t miss = h ^ (1ull << bit);
+            CHECK(DonutInfo::findFlavorByHash(miss) == flavorLinear(miss));
+        }
+    }
+    for (int t = 0; t < 100000; t++) {
+        uint64_t h = rng();
+        CHECK(DonutInfo::findFlavorByHash(h) == flavorLinear(h));
+    }
+    CHECK(std::strcmp(DonutInfo::getFlavorName(0), "(none)") == 0);
+
+    // Real flavors, as read from a pocket, with some misses.
+    std::vector<uint64_t> hashes(1 << 16);
+    for (auto& h : hashes)
+        h = rng() % 4 ? DonutInfo::FLAVORS[rng() % DonutInfo::FLAVOR_COUNT].hash : rng();
+    double perfect = bestMicros(20, [&] {
+        long sum = 0;
+        for (uint64_t h : hashes)
+            sum += DonutInfo::findFlavorByHash(h);
+        g_sink = sum;
+    });
+    double linear = bestMicros(20, [&] {
+        long sum = 0;
+        for (uint64_t h : hashes)
+            sum += flavorLinear(h);
+        g_sink = sum;
+    });
+    std::printf("flavor lookup x%zu: perfect hash %.0f us, linear search %.0f us (%.1fx)\n",
+                hashes.size(), perfect, linear, linear / perfect);
+}
+
+// --- Batched recalc: recalcAll against recalcStats per slot ---
+
+static uint16_t randomBerry() {
+    switch (rng() % 4) {
+        case 0: return 0;
+        case 1: return DonutInfo::VALID_BERRY_IDS[rng() % DonutInfo::VALID_BERRY_COUNT];
+        case 2: return DonutInfo::BERRIES[rng() % DonutInfo::BERRY_COUNT].item;
+        default: return static_cast<uint16_t>(rng());
+    }
+}
+
+static void testRecalcAll() {
+    const size_t pocketSize = Donut9a::MAX_COUNT * Donut9a::SIZE;
+    std::vector<uint8_t> scalar(pocketSize), batched;
+    bool selected[Donut9a::MAX_COUNT];
+    for (int round = 0; round < 300; round++) {
+        // Random bytes everywhere, then a mix of empty, known and unknown berries.
+        for (auto& x : scalar)
+            x = static_cast<uint8_t>(rng());
+        for (int i = 0; i < Donut9a::MAX_COUNT; i++) {
+            Donut9a d{scalar.data() + i * Donut9a::SIZE};
+            for (int j = 0; j < Donut9a::MAX_BERRIES; j++)
+                d.setBerry(j, randomBerry());
+            selected[i] = rng() & 1;
+        }
+        bool all = round % 3 == 0;
+        batched = scalar;
+        for (int i = 0; i < Donut9a::MAX_COUNT; i++) {
+            if (all || selected[i]) {
+                Donut9a d{scalar.data() + i * Donut9a::SIZE};
+                DonutInfo::recalcStats(d);
+            }
+        }
+        DonutInfo::recalcAll(batched.data(), all ? nullptr : selected);
+        CHECK(batched == scalar);
+    }
+
+    double perSlot = bestMicros(20, [&] {
+        for (int i = 0; i < Donut9a::MAX_COUNT; i++) {
+            Donut9a d{scalar.data() + i * Donut9a::SIZE};
+            DonutInfo::recalcStats(d);
+        }
+    });
+    double batch = bestMicros(20, [&] { DonutInfo::recalcAll(batched.data()); });
+    std::printf("recalc %d slots: recalcStats loop %.1f us, recalcAll %.1f us (%.1fx)\n",
+                Donut9a::MAX_COUNT, perSlot, batch, perSlot / batch);
+}
+
+// --- Pocket audit: one issue bit per field, dirty passes, clean fills ---
+
+static constexpr size_t POCKET_SIZE = Donut9a::MAX_COUNT * Donut9a::SIZE;
+
+static Donut9a slotOf(std::vector<uint8_t>& pocket, int i) {
+    return Donut9a{pocket.data() + i * Donut9a::SIZE};
+}
+
+static bool auditClean(const std::vector<uint8_t>& pocket) {
+    uint8_t issues[Donut9a::MAX_COUNT];
+    DonutInfo::auditPocket(pocket.data(), issues);
+    for (uint8_t x : issues)
+        if (x != 0)
+            return false;
+    return true;
+}
+
+// Breaks one field of slot i so that only the given issue applies; a
+// duplicate timestamp is copied from slot partner.
+static void corrupt(std::vector<uint8_t>& pocket, int i, uint8_t issue, int partner) {
+    Donut9a d = slotOf(pocket, i);
+    switch (issue) {
+        case DonutIssue::BadBerry:
+            d.setBerry(3, 0xFFFF);
+            DonutInfo::recalcStats(d);
+            break;
+        case DonutIssue::BadFlavor:
+            d.setFlavor(1, 0x0123456789ABCDEFull);
+            break;
+        case DonutIssue::StatMismatch:
+            d.setCalories(static_cast<uint16_t>(d.calories() + 1));
+            break;
+        case DonutIssue::BadDateTime:
+            d.data[0x24] = static_cast<uint8_t>((d.data[0x24] + 1) % 60);
+            break;
+        case DonutIssue::DupTimestamp:
+            std::memcpy(d.data, pocket.data() + partner * Donut9a::SIZE, 8);
+            std::memcpy(d.data + 0x20, pocket.data() + partner * Donut9a::SIZE + 0x20, 8);
+            break;
+        case DonutIssue::Reserved:
+            d.data[0x40 + rng() % 8] = 1;
+            break;
+    }
+}
+
+static void testAuditPocket() {
+    std::vector<uint8_t> shiny(POCKET_SIZE), lv3(POCKET_SIZE);
+    DonutInfo::fillAllShiny(shiny.data());
+    DonutInfo::fillAllRandomLv3(lv3.data());
+    CHECK(auditClean(shiny));
+    CHECK(auditClean(lv3));
+
+    // Each corruption sets its own bit on its slot (and the partner of a
+    // duplicate timestamp), nothing else anywhere.
+    uint8_t issues[Donut9a::MAX_COUNT];
+    for (int bit = 0; bit < DonutIssue::COUNT; bit++) {
+        auto issue = static_cast<uint8_t>(1 << bit);
+        std::vector<uint8_t> pocket = lv3;
+        int i = static_cast<int>(rng() % Donut9a::MAX_COUNT);
+        int partner = (i + 1 + static_cast<int>(rng() % (Donut9a::MAX_COUNT - 1))) % Donut9a::MAX_COUNT;
+        corrupt(pocket, i, issue, partner);
+        DonutInfo::auditPocket(pocket.data(), issues);
+        bool exact = true;
+        for (int s = 0; s < Donut9a::MAX_COUNT; s++) {
+            bool flagged = s == i || (issue == DonutIssue::DupTimestamp && s == partner);
+            exact &= issues[s] == (flagged ? issue : 0);
+        }
+        CHECK(exact);
+    }
+
+    // Rechecking only the edited slots matches a full pass, edits that
+    // fix or empty a flagged slot included.
+    std::vector<uint8_t> pocket = lv3;
+    uint8_t incremental[Donut9a::MAX_COUNT];
+    DonutInfo::auditPocket(pocket.data(), incremental);
+    bool same = true;
+    for (int round = 0; round < 200; round++) {
+        bool dirty[Donut9a::MAX_COUNT] = {};
+        for (int e = 0; e < 1 + static_cast<int>(rng() % 5); e++) {
+            int i = static_cast<int>(rng() % Donut9a::MAX_COUNT);
+            dirty[i] = true;
+            switch (rng() % 4) {
+                case 0: slotOf(pocket, i).clear(); break;
+                case 1: std::memcpy(pocket.data() + i * Donut9a::SIZE,
+                                    lv3.data() + i * Donut9a::SIZE, Donut9a::SIZE); break;
+                default:
+                    corrupt(pocket, i, static_cast<uint8_t>(1 << (rng() % DonutIssue::COUNT)),
+                            static_cast<int>(rng() % Donut9a::MAX_COUNT));
+                    break;
+            }
+        }
+        DonutInfo::auditPocket(pocket.data(), incremental, dirty);
+        DonutInfo::auditPocket(pocket.data(), issues);
+        same &= std::memcmp(incremental, issues, sizeof(issues)) == 0;
+    }
+    CHECK(same);
+
+    // Single-slot fills in the same second get distinct timestamps when
+    // given their pocket.
+    std::vector<uint8_t> fills(POCKET_SIZE);
+    for (int i = 0; i < 10; i++) {
+        Donut9a d = slotOf(fills, i);
+        switch (i % 3) {
+            case 0: DonutInfo::fillOneShiny(d, fills.data()); break;
+            case 1: DonutInfo::fillOneShinyRandom(d, fills.data()); break;
+            default: DonutInfo::fillOneRandomLv3(d, fills.data()); break;
+        }
+    }
+    CHECK(auditClean(fills));
+    Donut9a again = slotOf(fills, 0);
+    DonutInfo::fillOneShiny(again, fills.data());
+    CHECK(auditClean(fills));
+}
+
+int main() {
+    testBerryLookup();
+    testRecalcIndex();
+    testFlavorLookup();
+    testRecalcAll();
+    testAuditPocket();
+    return testResult("test_donut");
+}
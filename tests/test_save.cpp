@@ -0,0 +1,173 @@
+#include "save_file.h"
+#include "test_util.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::mt19937_64 rng(0x5A7E);
+
+static constexpr uint32_t KDONUTS = 0xBE007476;
+static constexpr size_t DONUT_BLOCK_SIZE = 999 * Donut9a::SIZE;
+
+// --- Synthetic save and file helpers ---
+
+// A few hundred random blocks with the donut block in the middle, hashed
+// like a save from the game.
+static std::vector<uint8_t> makeSave() {
+    std::vector<SCBlock> blocks;
+    std::vector<std::vector<uint8_t>> payloads;
+    const int count = 400;
+    for (int i = 0; i < count; i++) {
+        SCBlock b{};
+        b.key = i == count / 2 ? KDONUTS : static_cast<uint32_t>(rng());
+        if (b.key == KDONUTS) {
+            b.type = SCTypeCode::Object;
+            b.dataLen = DONUT_BLOCK_SIZE;
+        } else if (rng() % 2) {
+            b.type = SCTypeCode::UInt32;
+            b.dataLen = 4;
+        } else {
+            b.type = SCTypeCode::Object;
+            b.dataLen = rng() % 500;
+        }
+        payloads.emplace_back(b.dataLen);
+        for (auto& x : payloads.back())
+            x = static_cast<uint8_t>(rng());
+        blocks.push_back(b);
+    }
+
+    size_t payloadLen = 0;
+    for (auto& b : blocks)
+        payloadLen += b.encodedSize();
+    std::vector<uint8_t> image(payloadLen + SwishCrypto::SIZE_HASH);
+    size_t offset = 0;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        blocks[i].data = payloads[i].data();
+        offset += blocks[i].writeBlock(image.data() + offset);
+    }
+    SwishCrypto::cryptStaticXorpadBytes(image.data(), payloadLen);
+
+    SCBlockStore store = SwishCrypto::decrypt(std::move(image));
+    for (auto& b : store.blocks)
+        b.dirty = true;
+    return SwishCrypto::encrypt(store);
+}
+
+// The file a full re-encryption of original with donuts as the donut
+// block would give.
+static std::vector<uint8_t> expected(const std::vector<uint8_t>& original, const uint8_t* donuts) {
+    SCBlockStore store = SwishCrypto::decrypt(original);
+    SCBlock* b = SwishCrypto::findBlock(store, KDONUTS);
+    std::memcpy(b->data, donuts, b->dataLen);
+    b->dirty = true;
+    return SwishCrypto::encrypt(store);
+}
+
+static std::vector<uint8_t> readFile(const fs::path& path) {
+    std::ifstream f(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(f), {});
+}
+
+static void writeFile(const fs::path& path, const std::vector<uint8_t>& data) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+// Overwrites n random donut slots with random bytes.
+static void editSlots(SaveFile& save, int n) {
+    uint8_t* donuts = save.donutBlockData();
+    for (int i = 0; i < n; i++) {
+        size_t pos = (rng() % 999) * Donut9a::SIZE;
+        for (int j = 0; j < Donut9a::SIZE; j++)
+            donuts[pos + j] = static_cast<uint8_t>(rng());
+    }
+}
+
+// --- SaveFile: slot patches written in place and elsewhere ---
+
+static void testSaveFile() {
+    const fs::path dir = fs::temp_directory_path() / ("test_save_" + std::to_string(rng()));
+    const fs::path away = dir.string() + ".away";
+    const fs::path main = dir / "main";
+    const fs::path other = dir / "other";
+    fs::create_directories(dir);
+
+    const std::vector<uint8_t> original = makeSave();
+    writeFile(main, original);
+
+    SaveFile save;
+    CHECK(save.load(main.string()));
+    CHECK(save.hasDonutBlock());
+    if (!save.hasDonutBlock())
+        return;
+    CHECK(!save.hasUnsavedChanges());
+
+    // Edit, save in place, reload: the file is what a full re-encryption
+    // gives and holds the edits.
+    editSlots(save, 3);
+    CHECK(save.hasUnsavedChanges());
+    std::vector<uint8_t> want = expected(original, save.donutBlockData());
+    CHECK(save.save(main.string()));
+    CHECK(readFile(main) == want);
+    CHECK(!save.hasUnsavedChanges());
+    CHECK(save.verifyRoundTrip() == "OK");
+    {
+        SaveFile reloaded;
+        CHECK(reloaded.load(main.string()));
+        CHECK(reloaded.hasDonutBlock() &&
+              std::memcmp(reloaded.donutBlockData(), save.donutBlockData(), DONUT_BLOCK_SIZE) == 0);
+    }
+
+    // Save elsewhere, then back: the loaded file is untouched until the
+    // second save, which writes the ranges the first one patched.
+    editSlots(save, 2);
+    std::vector<uint8_t> want2 = expected(original, save.donutBlockData());
+    CHECK(save.save(other.string()));
+    CHECK(readFile(other) == want2);
+    CHECK(readFile(main) == want);
+    CHECK(save.hasUnsavedChanges());
+    CHECK(save.save(main.string()));
+    CHECK(readFile(main) == want2);
+    CHECK(!save.hasUnsavedChanges());
+
+    // A save that cannot open the file fails and keeps the patched ranges
+    // pending; the next save writes them.
+    editSlots(save, 4);
+    std::vector<uint8_t> want3 = expected(original, save.donutBlockData());
+    fs::rename(dir, away);
+    CHECK(!save.save(main.string()));
+    CHECK(save.hasUnsavedChanges());
+    fs::rename(away, dir);
+    CHECK(readFile(main) == want2);
+    CHECK(save.save(main.string()));
+    CHECK(readFile(main) == want3);
+    CHECK(!save.hasUnsavedChanges());
+
+    // No changes, or a slot edited back to what was saved: save() returns
+    // without opening the file, so it succeeds even with the file gone.
+    fs::rename(dir, away);
+    CHECK(save.save(main.string()));
+    uint8_t* slot = save.donutBlockData() + 17 * Donut9a::SIZE;
+    uint8_t keep[Donut9a::SIZE];
+    std::memcpy(keep, slot, sizeof(keep));
+    slot[5] ^= 0xFF;
+    CHECK(save.hasUnsavedChanges());
+    std::memcpy(slot, keep, sizeof(keep));
+    CHECK(!save.hasUnsavedChanges());
+    CHECK(save.save(main.string()));
+    fs::rename(away, dir);
+    CHECK(readFile(main) == want3);
+
+    fs::remove_all(dir);
+}
+
+int main() {
+    testSaveFile();
+    return testResult("test_save");
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+
+// Minimal check and timing helpers shared by the host tests.
+
+inline int g_failures = 0;
+
+#define CHECK(cond)                                                                   \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);     \
+            g_failures++;                                                             \
+        }                                                                             \
+    } while (0)
+
+// Best of reps runs of f, in microseconds.
+template <typename F>
+double bestMicros(int reps, F f) {
+    double best = 1e300;
+    for (int r = 0; r < reps; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        auto t1 = std::chrono::steady_clock::now();
+        double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+        if (us < best)
+            best = us;
+    }
+    return best;
+}
+
+inline int testResult(const char* name) {
+    std::printf("%s: %s\n", name, g_failures ? "FAILED" : "all checks passed");
+    return g_failures ? 1 : 0;
+}